@@ -0,0 +1,69 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <mmio/MatrixMarketFile.hpp>
+#include <mmio/arrow.hpp>
+#include <mmio/builders.hpp>
+#include <cstdio>
+#include <cstdlib>
+
+using Index = std::int32_t;
+using Value = double;
+
+/// Print the top-level layout of an exported array and release it.
+static void report(const char* kind, ArrowArray* array, ArrowSchema* schema)
+{
+  printf("%s: format %s, length %jd, children %jd",
+         kind, schema->format, std::intmax_t(array->length), std::intmax_t(array->n_children));
+  for (std::int64_t i = 0; i < schema->n_children; ++i) {
+    printf("%s %s:%s", (i) ? "," : "", schema->children[i]->name, schema->children[i]->format);
+  }
+  printf("\n");
+  array->release(array);
+  schema->release(schema);
+}
+
+int main(int argc, char* const argv[])
+{
+  if (argc != 2) {
+    fprintf(stderr, "usage: mmio_arrow_example <path>\n");
+    return EXIT_FAILURE;
+  }
+  mmio::MatrixMarketFile mm(argv[1]);
+
+  ArrowArray array;
+  ArrowSchema schema;
+  mmio::export_arrow(mmio::build_coo<Index, Value>(mm), &array, &schema);
+  report("coo", &array, &schema);
+  mmio::export_arrow(mmio::build_csr<Index, Value>(mm), &array, &schema);
+  report("csr", &array, &schema);
+  mmio::export_arrow(mmio::build_csc<Index, Value>(mm), &array, &schema);
+  report("csc", &array, &schema);
+  return 0;
+}
@@ -0,0 +1,274 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <mmio/MatrixMarketFile.hpp>
+#include <mmio/binary.hpp>
+#include <mmio/builders.hpp>
+#include <mmio/npy.hpp>
+#include <mmio/writers.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using Index = std::int32_t;
+using Value = double;
+using Clock = std::chrono::steady_clock;
+
+enum Format { MTX, COO, CSR, NPZ };
+
+static Format format(const std::filesystem::path& path)
+{
+  if (path.extension() == ".coo") {
+    return COO;
+  }
+  if (path.extension() == ".csr") {
+    return CSR;
+  }
+  if (path.extension() == ".npz") {
+    return NPZ;
+  }
+  return MTX;
+}
+
+/// Timings and sizes of each phase, reported with `-i`.
+struct Stats
+{
+  std::vector<std::pair<const char*, double>> phases;
+  Clock::time_point start = Clock::now();
+
+  void phase(const char* name) {
+    auto now = Clock::now();
+    phases.emplace_back(name, std::chrono::duration<double>(now - start).count());
+    start = now;
+  }
+};
+
+/// `s` as a JSON string literal.
+static std::string json_string(std::string_view s)
+{
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20) {
+      char buffer[8];
+      snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+      out += buffer;
+    }
+    else {
+      out += c;
+    }
+  }
+  return out + '"';
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: mmio-convert [-t threads] [-m budget-MiB] [-i stats-path] <input> <output>\n"
+                  "  .coo files are binary caches, .csr files are CSR binaries,\n"
+                  "  .npz outputs are scipy.sparse CSR archives,\n"
+                  "  anything else is Matrix Market\n");
+}
+
+/// Expand the rows of a CSR matrix back into COO form.
+static mmio::coo<Index, Value> to_coo(mmio::csr<Index, Value>&& A, int threads)
+{
+  mmio::coo<Index, Value> B;
+  B.n_rows = A.n_rows;
+  B.n_cols = A.n_cols;
+  B.rows.resize(A.nnz());
+  B.cols = std::move(A.indices);
+  B.values = std::move(A.values);
+  mmio::parallel(threads, [&](int t) {
+    for (Index i = A.row_block_begin(threads, t), e = A.row_block_begin(threads, t + 1); i < e; ++i) {
+      std::fill(&B.rows[A.offsets[i]], &B.rows[A.offsets[i + 1]], i);
+    }
+  });
+  return B;
+}
+
+int main(int argc, char* const argv[])
+{
+  int threads = mmio::default_threads();
+  std::size_t budget = std::size_t(1) << 30;
+  const char* stats_path = nullptr;
+
+  for (int c; (c = getopt(argc, argv, "t:m:i:h")) != -1; ) {
+    switch (c) {
+     case 't': threads = std::max(1, std::atoi(optarg)); break;
+     case 'm': budget = std::max(1l, std::atol(optarg)) << 20; break;
+     case 'i': stats_path = optarg; break;
+     default:
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc - optind != 2) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  std::filesystem::path input = argv[optind];
+  std::filesystem::path output = argv[optind + 1];
+  Format from = format(input);
+  Format to = format(output);
+  if (from == NPZ) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  // Only real parts are parsed, so complex files would lose their imaginary
+  // parts in every output format.
+  if (from == MTX && mmio::MatrixMarketFile(input).isComplex()) {
+    fprintf(stderr, "mmio-convert: complex matrices are not supported\n");
+    return EXIT_FAILURE;
+  }
+
+  Stats stats;
+  std::string typecode;
+  std::ptrdiff_t nnz = 0;
+
+  if (to == NPZ) {
+    // .npz archives hold full-storage CSR, like `scipy.sparse.save_npz`.
+    mmio::csr<Index, Value> A;
+    if (from == MTX) {
+      mmio::MatrixMarketFile mm(input);
+      typecode.assign(mm.getTypecode(), 4);
+      A = mmio::build_csr<Index, Value>(mm, threads);
+    }
+    else if (from == COO) {
+      typecode.assign(mmio::read_binary_header(input).typecode, 4);
+      A = mmio::to_csr(mmio::read_coo<Index, Value>(input, mmio::symmetric_storage::full, threads), threads);
+    }
+    else {
+      typecode.assign(mmio::read_binary_header(input).typecode, 4);
+      A = mmio::read_csr<Index, Value>(input, threads);
+    }
+    nnz = A.nnz();
+    stats.phase("load");
+    mmio::write_npz(output, A, threads);
+    stats.phase("write");
+  }
+  else if (from == MTX) {
+    mmio::MatrixMarketFile mm(input);
+    typecode.assign(mm.getTypecode(), 4);
+    stats.phase("open");
+
+    if (to == COO) {
+      nnz = mmio::convert_to_binary<Index, Value>(mm, output, budget, threads).nnz;
+      stats.phase("convert");
+    }
+    else if (to == CSR) {
+      double bytes = 2.0 * mm.getNEdges() * (2 * sizeof(Index) + sizeof(Value));
+      if (budget < bytes) {
+        fprintf(stderr, "warning: building CSR needs about %.0f MiB, over the budget\n", bytes / (1 << 20));
+      }
+      auto A = mmio::build_csr<Index, Value>(mm, threads);
+      nnz = A.nnz();
+      stats.phase("build");
+      mmio::write_binary(output, A, typecode, threads);
+      stats.phase("write");
+    }
+    else {
+      auto A = mmio::build_coo<Index, Value>(mm, mmio::symmetric_storage::stored, threads);
+      nnz = A.nnz();
+      stats.phase("load");
+      mmio::write_mtx(output, A, typecode, mmio::symmetric_storage::stored, threads);
+      stats.phase("write");
+    }
+  }
+  else if (from == COO) {
+    typecode.assign(mmio::read_binary_header(input).typecode, 4);
+    if (to == CSR) {
+      auto A = mmio::to_csr(mmio::read_coo<Index, Value>(input, mmio::symmetric_storage::full, threads), threads);
+      nnz = A.nnz();
+      stats.phase("load");
+      mmio::write_binary(output, A, typecode, threads);
+    }
+    else {
+      auto A = mmio::read_coo<Index, Value>(input, mmio::symmetric_storage::stored, threads);
+      nnz = A.nnz();
+      stats.phase("load");
+      if (to == COO) {
+        mmio::write_binary(output, A, typecode, threads);
+      }
+      else {
+        mmio::write_mtx(output, A, typecode, mmio::symmetric_storage::stored, threads);
+      }
+    }
+    stats.phase("write");
+  }
+  else {
+    typecode.assign(mmio::read_binary_header(input).typecode, 4);
+    auto A = mmio::read_csr<Index, Value>(input, threads);
+    nnz = A.nnz();
+    stats.phase("load");
+    if (to == CSR) {
+      mmio::write_binary(output, A, typecode, threads);
+    }
+    else if (to == COO) {
+      // CSR binaries hold full storage, so the cache is written as general.
+      typecode[3] = 'G';
+      mmio::write_binary(output, to_coo(std::move(A), threads), typecode, threads);
+    }
+    else {
+      mmio::write_mtx(output, A, typecode, mmio::symmetric_storage::full, threads);
+    }
+    stats.phase("write");
+  }
+
+  if (stats_path) {
+    FILE* f = (std::string_view(stats_path) == "-") ? stdout : fopen(stats_path, "w");
+    if (f == nullptr) {
+      fprintf(stderr, "fopen failed, %d: %s\n", errno, strerror(errno));
+      return EXIT_FAILURE;
+    }
+    fprintf(f, "{\"input\": %s, \"output\": %s, \"threads\": %d, \"budget\": %zu, \"nnz\": %td, "
+            "\"bytes_in\": %ju, \"bytes_out\": %ju",
+            json_string(input.native()).c_str(), json_string(output.native()).c_str(), threads, budget, nnz,
+            std::uintmax_t(std::filesystem::file_size(input)),
+            std::uintmax_t(std::filesystem::file_size(output)));
+    for (auto&& [name, t] : stats.phases) {
+      fprintf(f, ", \"%s_ms\": %.3f", name, t * 1e3);
+    }
+    fprintf(f, "}\n");
+    if (f != stdout) {
+      fclose(f);
+    }
+  }
+
+  return 0;
+}
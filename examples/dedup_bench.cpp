@@ -0,0 +1,171 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <mmio/MatrixMarketFile.hpp>
+#include <mmio/builders.hpp>
+#include <mmio/dedup.hpp>
+#include <mmio/parallel.hpp>
+#include <mmio/writers.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+
+using Index = std::int32_t;
+using Value = double;
+using Clock = std::chrono::steady_clock;
+
+static double seconds(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: mmio_dedup_bench [-t threads] [-n runs] <path>\n"
+                  "       mmio_dedup_bench [-t threads] [-n runs] -r scale [-e edge-factor] -o <output>\n"
+                  "  -r writes an R-MAT graph with 2^scale vertices to <output> and times that\n");
+}
+
+/// An R-MAT graph (a = 0.57, b = c = 0.19) with small integer weights, so
+/// that sums of duplicates are exact in any order.
+static mmio::coo<Index, Value> rmat(int scale, int edge_factor, int p)
+{
+  mmio::coo<Index, Value> A;
+  A.n_rows = A.n_cols = Index(1) << scale;
+  std::ptrdiff_t n = std::ptrdiff_t(edge_factor) << scale;
+  A.rows.resize(n);
+  A.cols.resize(n);
+  A.values.resize(n);
+  mmio::parallel_for(n, p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t e) {
+    std::mt19937_64 rng(t + 1);
+    std::uniform_real_distribution<double> coin;
+    for (; i < e; ++i) {
+      Index u = 0, v = 0;
+      for (int bit = 0; bit < scale; ++bit) {
+        double x = coin(rng);
+        u = (u << 1) | (x >= 0.76);
+        v = (v << 1) | (0.57 <= x && x < 0.76) | (x >= 0.95);
+      }
+      A.rows[i] = u;
+      A.cols[i] = v;
+      A.values[i] = 1 + rng() % 8;
+    }
+  });
+  return A;
+}
+
+int main(int argc, char* const argv[])
+{
+  int threads = mmio::default_threads();
+  int runs = 3;
+  int scale = 0;
+  int edge_factor = 16;
+  const char* output = nullptr;
+
+  for (int c; (c = getopt(argc, argv, "t:n:r:e:o:h")) != -1; ) {
+    switch (c) {
+     case 't': threads = std::max(1, std::atoi(optarg)); break;
+     case 'n': runs = std::max(1, std::atoi(optarg)); break;
+     case 'r': scale = std::clamp(std::atoi(optarg), 1, 30); break;
+     case 'e': edge_factor = std::max(1, std::atoi(optarg)); break;
+     case 'o': output = optarg; break;
+     default:
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  // A generated graph goes only to an explicit output, never over an input.
+  if ((scale != 0) != (output != nullptr) || argc - optind != (output ? 0 : 1)) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  std::filesystem::path path = (output) ? output : argv[optind];
+
+  if (scale) {
+    auto start = Clock::now();
+    mmio::write_mtx(path, rmat(scale, edge_factor, threads), "MCRG", mmio::symmetric_storage::stored, threads);
+    printf("generate %7.3f ms\n", seconds(start) * 1e3);
+  }
+
+  mmio::MatrixMarketFile mm(path);
+  printf("rows %d, entries %d, threads %d\n", mm.getNRows(), mm.getNEdges(), threads);
+
+  double hash = 1e30, sort = 1e30;
+  std::ptrdiff_t loaded = 0;
+  mmio::coo<Index, Value> H;
+  mmio::csr<Index, Value> S;
+  for (int r = 0; r < runs; ++r) {
+    auto start = Clock::now();
+    H = mmio::dedup_edges<Index, Value>(mm, std::plus<>(), mmio::symmetric_storage::full, threads);
+    hash = std::min(hash, seconds(start));
+
+    start = Clock::now();
+    S = mmio::build_csr<Index, Value>(mm, threads);
+    loaded = S.nnz();
+    mmio::combine_duplicates(S, std::plus<>(), threads);
+    sort = std::min(sort, seconds(start));
+  }
+
+  // Both should produce the same distinct entries and combined values.
+  std::vector<std::tuple<Index, Index, Value>> a, b;
+  for (std::ptrdiff_t k = 0; k < H.nnz(); ++k) {
+    a.emplace_back(H.rows[k], H.cols[k], H.values[k]);
+  }
+  for (Index i = 0; i < S.n_rows; ++i) {
+    for (Index k = S.offsets[i]; k < S.offsets[i + 1]; ++k) {
+      b.emplace_back(i, S.indices[k], S.values[k]);
+    }
+  }
+  std::sort(a.begin(), a.end());
+
+  printf("unique %td of %td (%.1f%% duplicates)\n", H.nnz(), loaded,
+         100.0 * (1.0 - double(H.nnz()) / std::max<std::ptrdiff_t>(1, loaded)));
+  printf("hash %10.3f ms\n", hash * 1e3);
+  printf("sort %10.3f ms\n", sort * 1e3);
+  // Duplicates are combined in a different order, so values may round
+  // differently unless they are integers.
+  bool same = a.size() == b.size();
+  for (std::size_t k = 0; same && k < a.size(); ++k) {
+    auto [u, v, x] = a[k];
+    auto [i, j, y] = b[k];
+    same = u == i && v == j && std::abs(x - y) <= 1e-9 * std::max(1.0, std::abs(y));
+  }
+  if (!same) {
+    fprintf(stderr, "hash and sort results differ (%zu and %zu entries)\n", a.size(), b.size());
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
@@ -0,0 +1,334 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <mmio/MatrixMarketFile.hpp>
+#include <mmio/builders.hpp>
+#include <mmio/parallel.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using Vertex = std::int32_t;
+using Graph = mmio::csr<Vertex, float>;
+using Clock = std::chrono::steady_clock;
+
+static double seconds(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static auto neighbors(const Graph& g, Vertex u)
+{
+  return std::span(g.indices).subspan(g.offsets[u], g.offsets[u + 1] - g.offsets[u]);
+}
+
+/// Direction-optimizing breadth-first search (Beamer et al.).
+///
+/// Top-down steps expand a queue frontier along out-edges, bottom-up steps
+/// let each unvisited vertex search its in-edges for a parent in a bitmap
+/// frontier. Returns the parent array, with -1 for unreached vertices.
+static std::vector<Vertex> bfs(const Graph& out, const Graph& in, Vertex source, int p)
+{
+  constexpr int alpha = 15;
+  constexpr int beta = 18;
+
+  Vertex n = out.n_rows;
+  std::vector<Vertex> parent(n, -1);
+  parent[source] = source;
+
+  std::vector<Vertex> queue = { source };
+  std::vector<std::uint8_t> front(n), next(n);
+  std::int64_t edges_to_check = out.nnz();
+  std::int64_t scout = out.offsets[source + 1] - out.offsets[source];
+
+  while (!queue.empty()) {
+    if (scout > edges_to_check / alpha) {
+      // Bottom-up until the frontier shrinks again.
+      std::fill(front.begin(), front.end(), 0);
+      for (Vertex u : queue) {
+        front[u] = 1;
+      }
+      std::int64_t awake = queue.size(), old_awake;
+      do {
+        old_awake = awake;
+        std::vector<std::int64_t> counts(p);
+        mmio::parallel_for(n, p, [&](int t, std::ptrdiff_t v, std::ptrdiff_t e) {
+          for (; v < e; ++v) {
+            next[v] = 0;
+            if (parent[v] >= 0) {
+              continue;
+            }
+            for (Vertex u : neighbors(in, v)) {
+              if (front[u]) {
+                parent[v] = u;
+                next[v] = 1;
+                ++counts[t];
+                break;
+              }
+            }
+          }
+        });
+        std::swap(front, next);
+        awake = 0;
+        for (auto c : counts) {
+          awake += c;
+        }
+      } while (awake >= old_awake || awake > n / beta);
+
+      queue.clear();
+      for (Vertex v = 0; v < n; ++v) {
+        if (front[v]) {
+          queue.push_back(v);
+        }
+      }
+      scout = 1;
+      continue;
+    }
+
+    // Top-down step.
+    edges_to_check -= scout;
+    std::vector<std::vector<Vertex>> local(p);
+    std::vector<std::int64_t> scouts(p);
+    mmio::parallel_for(queue.size(), p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t e) {
+      for (; i < e; ++i) {
+        Vertex u = queue[i];
+        for (Vertex v : neighbors(out, u)) {
+          Vertex expected = -1;
+          if (std::atomic_ref(parent[v]).load(std::memory_order_relaxed) < 0 &&
+              std::atomic_ref(parent[v]).compare_exchange_strong(expected, u)) {
+            local[t].push_back(v);
+            scouts[t] += out.offsets[v + 1] - out.offsets[v];
+          }
+        }
+      }
+    });
+    queue.clear();
+    scout = 0;
+    for (int t = 0; t < p; ++t) {
+      queue.insert(queue.end(), local[t].begin(), local[t].end());
+      scout += scouts[t];
+    }
+  }
+  return parent;
+}
+
+/// Pull-based PageRank over in-edges, iterated until the L1 change is small.
+static std::vector<float> pagerank(const Graph& out, const Graph& in, int p, int& iterations)
+{
+  constexpr float damping = 0.85f;
+  constexpr double epsilon = 1e-4;
+  constexpr int max_iterations = 20;
+
+  Vertex n = out.n_rows;
+  float base = (1.0f - damping) / n;
+  std::vector<float> rank(n, 1.0f / n), contrib(n);
+  for (iterations = 0; iterations < max_iterations; ) {
+    mmio::parallel_for(n, p, [&](int, std::ptrdiff_t u, std::ptrdiff_t e) {
+      for (; u < e; ++u) {
+        Vertex degree = out.offsets[u + 1] - out.offsets[u];
+        contrib[u] = (degree) ? rank[u] / degree : 0.0f;
+      }
+    });
+
+    // Every vertex is updated, including those with no in-edges.
+    std::vector<double> errors(p);
+    mmio::parallel_for(n, p, [&](int t, std::ptrdiff_t v, std::ptrdiff_t e) {
+      for (; v < e; ++v) {
+        float sum = 0.0f;
+        for (Vertex u : neighbors(in, v)) {
+          sum += contrib[u];
+        }
+        float r = base + damping * sum;
+        errors[t] += std::fabs(r - rank[v]);
+        rank[v] = r;
+      }
+    });
+
+    ++iterations;
+    double error = 0;
+    for (double e : errors) {
+      error += e;
+    }
+    if (error < epsilon) {
+      break;
+    }
+  }
+  return rank;
+}
+
+/// Hook the trees of `u` and `v` together (Afforest's lock-free link).
+static void link(Vertex u, Vertex v, std::vector<Vertex>& comp)
+{
+  Vertex p1 = std::atomic_ref(comp[u]).load(std::memory_order_relaxed);
+  Vertex p2 = std::atomic_ref(comp[v]).load(std::memory_order_relaxed);
+  while (p1 != p2) {
+    Vertex high = std::max(p1, p2);
+    Vertex low = p1 + p2 - high;
+    Vertex p_high = std::atomic_ref(comp[high]).load(std::memory_order_relaxed);
+    if (p_high == low) {
+      break;
+    }
+    if (p_high == high && std::atomic_ref(comp[high]).compare_exchange_strong(p_high, low)) {
+      break;
+    }
+    p1 = std::atomic_ref(comp[std::atomic_ref(comp[high]).load(std::memory_order_relaxed)]).load(std::memory_order_relaxed);
+    p2 = std::atomic_ref(comp[low]).load(std::memory_order_relaxed);
+  }
+}
+
+static void compress(std::vector<Vertex>& comp, int p)
+{
+  mmio::parallel_for(comp.size(), p, [&](int, std::ptrdiff_t u, std::ptrdiff_t e) {
+    auto load = [&](Vertex v) {
+      return std::atomic_ref(comp[v]).load(std::memory_order_relaxed);
+    };
+    for (; u < e; ++u) {
+      for (Vertex c; (c = load(load(u))) != comp[u]; ) {
+        std::atomic_ref(comp[u]).store(c, std::memory_order_relaxed);
+      }
+    }
+  });
+}
+
+/// Afforest connected components (Sutton et al.): link a few sampled
+/// neighbors per vertex, find the dominant component, then finish linking
+/// only the vertices outside of it.
+static std::vector<Vertex> afforest(const Graph& out, const Graph& in, int p)
+{
+  constexpr int rounds = 2;
+  constexpr int samples = 1024;
+
+  Vertex n = out.n_rows;
+  std::vector<Vertex> comp(n);
+  for (Vertex u = 0; u < n; ++u) {
+    comp[u] = u;
+  }
+
+  for (int r = 0; r < rounds; ++r) {
+    mmio::parallel_for(n, p, [&](int, std::ptrdiff_t u, std::ptrdiff_t e) {
+      for (; u < e; ++u) {
+        auto adj = neighbors(out, u);
+        if (r < std::ssize(adj)) {
+          link(u, adj[r], comp);
+        }
+      }
+    });
+    compress(comp, p);
+  }
+
+  std::unordered_map<Vertex, int> counts;
+  std::mt19937 gen(27491095);
+  std::uniform_int_distribution<Vertex> dist(0, std::max(n - 1, 0));
+  for (int i = 0; n && i < samples; ++i) {
+    ++counts[comp[dist(gen)]];
+  }
+  Vertex c = std::max_element(counts.begin(), counts.end(), [](auto& a, auto& b) {
+    return a.second < b.second;
+  })->first;
+
+  mmio::parallel_for(n, p, [&](int, std::ptrdiff_t u, std::ptrdiff_t e) {
+    for (; u < e; ++u) {
+      if (std::atomic_ref(comp[u]).load(std::memory_order_relaxed) == c) {
+        continue;
+      }
+      for (Vertex v : neighbors(out, u).subspan(std::min<std::ptrdiff_t>(rounds, out.offsets[u + 1] - out.offsets[u]))) {
+        link(u, v, comp);
+      }
+      for (Vertex v : neighbors(in, u)) {
+        link(u, v, comp);
+      }
+    }
+  });
+  compress(comp, p);
+  return comp;
+}
+
+int main(int argc, char* const argv[])
+{
+  if (argc < 2 || 4 < argc) {
+    fprintf(stderr, "usage: mmio_graph_bench <path> [threads] [source]\n");
+    return EXIT_FAILURE;
+  }
+  std::filesystem::path path = argv[1];
+  int threads = (argc > 2) ? std::atoi(argv[2]) : mmio::default_threads();
+  Vertex source = (argc > 3) ? std::atoi(argv[3]) : 0;
+
+  auto start = Clock::now();
+  mmio::MatrixMarketFile mm(path);
+  Graph out = mmio::build_csr<Vertex, float>(mm, threads);
+  double load = seconds(start);
+
+  // Treat the matrix as a square adjacency matrix over max(rows, cols)
+  // vertices, and transpose the out-edge CSR into the in-edge CSR.
+  start = Clock::now();
+  Vertex n = std::max(out.n_rows, out.n_cols);
+  out.offsets.resize(n + 1, out.offsets.back());
+  out.n_rows = out.n_cols = n;
+  Graph in = mmio::transpose(out, threads);
+  double build = seconds(start);
+
+  printf("vertices %d, edges %td, threads %d\n", out.n_rows, out.nnz(), threads);
+  printf("load %10.3f ms\n", load * 1e3);
+  printf("build %9.3f ms\n", build * 1e3);
+  if (out.n_rows == 0 || source < 0 || out.n_rows <= source) {
+    fprintf(stderr, "source %d out of range\n", source);
+    return EXIT_FAILURE;
+  }
+
+  start = Clock::now();
+  auto parent = bfs(out, in, source, threads);
+  double t = seconds(start);
+  auto reached = std::count_if(parent.begin(), parent.end(), [](Vertex v) { return v >= 0; });
+  printf("bfs %11.3f ms (reached %td)\n", t * 1e3, reached);
+
+  start = Clock::now();
+  int iterations;
+  auto rank = pagerank(out, in, threads, iterations);
+  t = seconds(start);
+  printf("pagerank %6.3f ms (%d iterations)\n", t * 1e3, iterations);
+
+  start = Clock::now();
+  auto comp = afforest(out, in, threads);
+  t = seconds(start);
+  Vertex components = 0;
+  for (Vertex u = 0; u < out.n_rows; ++u) {
+    components += (comp[u] == u);
+  }
+  printf("cc %12.3f ms (%d components)\n", t * 1e3, components);
+
+  return 0;
+}
@@ -0,0 +1,73 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <mmio/split.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+static void usage()
+{
+  fprintf(stderr, "usage: mmio-split [-t threads] [-r] <input> <shards> <output-stem>\n"
+                  "  writes <output-stem>-00000.mtx and so on, balanced by nnz,\n"
+                  "  or by contiguous row ranges with -r\n");
+}
+
+int main(int argc, char* const argv[])
+{
+  int threads = mmio::default_threads();
+  mmio::split_mode mode = mmio::split_mode::nnz;
+
+  for (int c; (c = getopt(argc, argv, "t:rh")) != -1; ) {
+    switch (c) {
+     case 't': threads = std::atoi(optarg); break;
+     case 'r': mode = mmio::split_mode::rows; break;
+     default:
+      usage();
+      return (c == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  if (argc - optind != 3) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  int n = std::atoi(argv[optind + 1]);
+  if (n < 1 || threads < 1) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  auto nnz = mmio::split_mtx(argv[optind], argv[optind + 2], n, mode, threads);
+  for (int i = 0; i < n; ++i) {
+    printf("%s %td\n", mmio::shard_path(argv[optind + 2], i).c_str(), nnz[i]);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <mmio/MatrixMarketFile.hpp>
+#include <mmio/builders.hpp>
+#include <mmio/kernels.hpp>
+#include <mmio/pipeline.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+using Index = std::int32_t;
+using Value = double;
+
+/// Time `iterations` calls to `f`, returning the average seconds per call.
+template <class F>
+static double time(int iterations, F&& f)
+{
+  f();                                          // warm up
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    f();
+  }
+  std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+  return t.count() / iterations;
+}
+
+/// Run `f` once over `y` filled with NaN and check that it leaves `want`, so
+/// rows a kernel never writes are caught along with wrong sums.
+template <class F>
+static bool check(const char* name, std::vector<Value>& y, const std::vector<Value>& want, F&& f)
+{
+  std::fill(y.begin(), y.end(), std::numeric_limits<Value>::quiet_NaN());
+  f();
+  for (std::size_t i = 0; i < want.size(); ++i) {
+    if (!(std::abs(y[i] - want[i]) <= 1e-9 * std::max(1.0, std::abs(want[i])))) {
+      fprintf(stderr, "%s: y[%zu] is %g, expected %g\n", name, i, y[i], want[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+static void report(const char* name, double t, double flops, double bytes)
+{
+  printf("%-16s %10.3f ms %8.3f GFLOP/s %8.3f GB/s\n",
+         name, t * 1e3, flops / t * 1e-9, bytes / t * 1e-9);
+}
+
+int main(int argc, char* const argv[])
+{
+  if (argc < 2 || 4 < argc) {
+    fprintf(stderr, "usage: mmio_spmv_bench <path> [threads] [iterations]\n");
+    return EXIT_FAILURE;
+  }
+  std::filesystem::path path = argv[1];
+  int threads = (argc > 2) ? std::atoi(argv[2]) : mmio::default_threads();
+  int iterations = (argc > 3) ? std::atoi(argv[3]) : 20;
+
+  auto start = std::chrono::steady_clock::now();
+  mmio::MatrixMarketFile mm(path);
+  auto coo = mmio::build_coo<Index, Value>(mm, threads);
+  auto loaded = std::chrono::steady_clock::now();
+  auto csr = mmio::to_csr(coo, threads);
+  auto built = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double> load = loaded - start;
+  std::chrono::duration<double> build = built - loaded;
+  printf("rows %d, cols %d, non-zeros %td, threads %d\n",
+         csr.n_rows, csr.n_cols, csr.nnz(), threads);
+  printf("load %.3f ms, build %.3f ms\n", load.count() * 1e3, build.count() * 1e3);
+
+  // Compare the direct CSR builders against the load-then-build path above.
+  start = std::chrono::steady_clock::now();
+  auto direct = mmio::build_csr<Index, Value>(mm, threads);
+  std::chrono::duration<double> direct_time = std::chrono::steady_clock::now() - start;
+
+  mmio::pipeline_options options = {
+    .parsers = std::max(1, threads / 2),
+    .consumers = std::max(1, threads - threads / 2)
+  };
+  start = std::chrono::steady_clock::now();
+  auto pipelined = mmio::build_csr_pipelined<Index, Value>(mm, mmio::symmetric_storage::full, options);
+  std::chrono::duration<double> pipelined_time = std::chrono::steady_clock::now() - start;
+  printf("build_csr %.3f ms, build_csr_pipelined %.3f ms\n",
+         direct_time.count() * 1e3, pipelined_time.count() * 1e3);
+  if (direct.nnz() != csr.nnz() || pipelined.nnz() != csr.nnz()) {
+    fprintf(stderr, "direct builders disagree on non-zeros\n");
+    return EXIT_FAILURE;
+  }
+
+  double n = csr.n_rows;
+  double m = csr.n_cols;
+  double nnz = csr.nnz();
+  double is = sizeof(Index);
+  double vs = sizeof(Value);
+
+  // Reference products, computed serially from the COO entries.
+  std::vector<Value> x(std::max(n, m));
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    x[i] = 1 + i % 7;
+  }
+  std::vector<Value> Ax(n), ATx(m);
+  for (std::ptrdiff_t k = 0; k < coo.nnz(); ++k) {
+    Ax[coo.rows[k]] += coo.values[k] * x[coo.cols[k]];
+    ATx[coo.cols[k]] += coo.values[k] * x[coo.rows[k]];
+  }
+  std::vector<Value> y(std::max(n, m));
+
+  auto run = [&](const char* name, std::vector<Value>& out, const std::vector<Value>& want,
+                 double flops, double bytes, auto&& f) {
+    if (!check(name, out, want, f)) {
+      return false;
+    }
+    report(name, time(iterations, f), flops, bytes);
+    return true;
+  };
+
+  bool ok = run("csr spmv", y, Ax, 2 * nnz, (n + 1) * is + nnz * (is + vs) + (m + n) * vs, [&] {
+    mmio::spmv(csr, x, y, threads);
+  });
+
+  auto blocked = mmio::compress_indices(csr, 1024, threads);
+  double ib = blocked.index_bytes();
+  ok &= run("blocked spmv", y, Ax, 2 * nnz, (n + 1) * is + ib + nnz * vs + (m + n) * vs, [&] {
+    mmio::spmv(blocked, x, y, threads);
+  });
+
+  ok &= run("coo spmv", y, Ax, 2 * nnz, nnz * (2 * is + vs) + (m + threads * n) * vs, [&] {
+    mmio::spmv(coo, x, y, threads);
+  });
+
+  ok &= run("csr spmv^T", y, ATx, 2 * nnz, (n + 1) * is + nnz * (is + vs) + (n + threads * m) * vs, [&] {
+    mmio::spmv_transpose(csr, x, y, threads);
+  });
+
+  if (mm.isSymmetric()) {
+    auto upper = mmio::build_csr<Index, Value>(mm, mmio::symmetric_storage::upper, threads);
+    double unnz = upper.nnz();
+    ok &= run("csr spmv sym", y, Ax, 2 * nnz, (n + 1) * is + unnz * (is + vs) + (m + threads * n) * vs, [&] {
+      mmio::spmv_symmetric(upper, x, y, threads);
+    });
+  }
+
+  for (int k : { 4, 16 }) {
+    // Every column of X is x, so every column of Y should be Ax.
+    std::vector<Value> X(m * k), Y(n * k), AX(n * k);
+    for (std::ptrdiff_t i = 0; i < m * k; ++i) {
+      X[i] = x[i / k];
+    }
+    for (std::ptrdiff_t i = 0; i < n * k; ++i) {
+      AX[i] = Ax[i / k];
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "csr spmm k=%d", k);
+    ok &= run(name, Y, AX, 2 * nnz * k, (n + 1) * is + nnz * (is + vs) + (m + n) * k * vs, [&] {
+      mmio::spmm(csr, X, Y, k, threads);
+    });
+  }
+
+  if (!ok) {
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
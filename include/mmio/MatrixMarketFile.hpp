@@ -29,10 +29,13 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include "mmio/values.hpp"
+
 #include <compare>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <string_view>
 #include <tuple>
 
 namespace mmio
@@ -48,9 +51,10 @@ namespace mmio
 ///
 /// ```
 /// MatrixMarketFile mm(path);
-/// for (auto&& [u, v, d] : edges<double>(mm)) {}      // <-- one double
-/// for (auto&& [u, v, i, j] : edges<int, int>(mm)) {} // <-- two ints
-/// for (auto&& [u, v] : edges(mm)) {}                 // <-- ignore attributes
+/// for (auto&& [u, v, d] : edges<double>(mm)) {}           // <-- one double
+/// for (auto&& [u, v, i, j] : edges<int, int>(mm)) {}      // <-- two ints
+/// for (auto&& [u, v] : edges(mm)) {}                      // <-- ignore attributes
+/// for (auto&& [u, v, s] : edges<std::string_view>(mm)) {} // <-- raw text
 /// ```
 class MatrixMarketFile
 {
@@ -61,6 +65,7 @@ class MatrixMarketFile
   const char* base_ = nullptr;                  // base pointer to mmap-ed file
   std::ptrdiff_t i_ = 0;                        // byte offset of the first edge
   std::ptrdiff_t e_ = 0;                        // bytes in the mmap-ed file
+  char        type_[4] = {};                    // the banner's MM_typecode
 
  public:
   MatrixMarketFile(std::filesystem::path);
@@ -81,6 +86,26 @@ class MatrixMarketFile
     return nnz_;
   }
 
+  /// Properties of the banner's MM_typecode.
+  bool isPattern() const;
+  bool isInteger() const;
+  bool isReal() const;
+  bool isComplex() const;
+  bool isGeneral() const;
+  bool isSymmetric() const;
+  bool isSkew() const;
+  bool isHermitian() const;
+
+  /// The raw MM_typecode, for use with the vendored mmio.h routines.
+  const char* getTypecode() const {
+    return type_;
+  }
+
+  /// The bytes of the whole mapped file, including the header.
+  std::string_view getBytes() const {
+    return { base_, std::size_t(e_) };
+  }
+
   /// Find the nth edge in the file.
   const char* edge(std::ptrdiff_t n) const;
 
@@ -93,37 +118,17 @@ class MatrixMarketFile
   {
     const char* i_ = nullptr;
 
+   public:
     /// Read the next token in the stream as a U, and update the pointer.
+    ///
+    /// Values are parsed by `value_parser<U>`, which users may specialize.
     template <class U>
     static U get(const char* (&i))
     {
-      // This horrible code is used because normal stream processing is very
-      // slow, while this direct version is just sort of slow.
-      U u;
-      char* e;
-      if constexpr (std::is_same_v<std::int32_t, U>) {
-        u = std::strtol(i, &e, 10);
-      }
-      if constexpr (std::is_same_v<std::uint32_t, U>) {
-        u = std::strtoul(i, &e, 10);
-      }
-      else if constexpr (std::is_same_v<std::int64_t, U>) {
-        u = std::strtol(i, &e, 10);
-      }
-      else if constexpr (std::is_same_v<std::uint64_t, U>) {
-        u = std::strtoul(i, &e, 10);
-      }
-      else if constexpr (std::is_same_v<float, U>) {
-        u = std::strtof(i, &e);
-      }
-      else {
-        u = std::strtod(i, &e);
-      }
-      i = e;
-      return u;
+      static_assert(parsable<U>, "no mmio::value_parser<U> for this value type");
+      return value_parser<U>::parse(i);
     }
 
-   public:
     using value_type = std::tuple<std::int32_t, std::int32_t, Vs...>;
 
     edge_iterator() = default;
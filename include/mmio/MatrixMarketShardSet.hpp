@@ -0,0 +1,242 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace mmio
+{
+/// A matrix stored as many .mtx shards, e.g., `part-00000.mtx` through
+/// `part-01023.mtx`, each with its own header.
+///
+/// Every shard must have the same dimensions and typecode. The edges of the
+/// set are numbered globally in shard order, so shard `i` holds edges
+/// `[getEdgeOffset(i), getEdgeOffset(i + 1))`.
+class MatrixMarketShardSet
+{
+  std::vector<std::unique_ptr<MatrixMarketFile>> shards_;
+  std::vector<std::ptrdiff_t> offsets_;         // first global edge of each shard
+
+ public:
+  /// Open and map all of `paths` concurrently with `p` threads.
+  ///
+  /// Opening is dominated by syscall and page-fault latency rather than CPU,
+  /// so the default uses more threads than cores.
+  explicit MatrixMarketShardSet(const std::vector<std::filesystem::path>& paths,
+                                int p = 4 * default_threads());
+
+  /// Release the memory mappings of every shard early.
+  void release();
+
+  std::int32_t getNRows() const {
+    return shards_.front()->getNRows();
+  }
+
+  std::int32_t getNCols() const {
+    return shards_.front()->getNCols();
+  }
+
+  /// The total number of edges in all shards.
+  std::ptrdiff_t getNEdges() const {
+    return offsets_.back();
+  }
+
+  std::ptrdiff_t getNShards() const {
+    return shards_.size();
+  }
+
+  /// The global ordinal of the first edge of shard `i`.
+  std::ptrdiff_t getEdgeOffset(std::ptrdiff_t i) const {
+    return offsets_[i];
+  }
+
+  /// The shard that holds global edge `n`.
+  std::ptrdiff_t getShard(std::ptrdiff_t n) const {
+    return std::upper_bound(offsets_.begin(), offsets_.end() - 1, n) - offsets_.begin() - 1;
+  }
+
+  const MatrixMarketFile& shard(std::ptrdiff_t i) const {
+    return *shards_[i];
+  }
+
+  /// Properties of the shared MM_typecode.
+  bool isPattern() const   { return shards_.front()->isPattern(); }
+  bool isGeneral() const   { return shards_.front()->isGeneral(); }
+  bool isSkew() const      { return shards_.front()->isSkew(); }
+  const char* getTypecode() const { return shards_.front()->getTypecode(); }
+};
+
+/// A line-aligned chunk of one shard, with the global ordinal of its first
+/// edge.
+struct shard_chunk
+{
+  std::ptrdiff_t shard = 0;
+  const char*    begin = nullptr;
+  const char*      end = nullptr;
+  std::ptrdiff_t first = 0;
+
+  template <class... Vs>
+  MatrixMarketFile::edge_range<Vs...> range() const {
+    return { begin, end };
+  }
+};
+
+/// Split the shards of `set` into about `n` chunks of similar size in bytes,
+/// counting lines with `p` threads so that each chunk knows the exact global
+/// ordinal of its first edge. Every shard gets at least one chunk, and the
+/// returned vector ends with a sentinel chunk whose `first` is the total edge
+/// count.
+inline static std::vector<shard_chunk>
+partition_shards(const MatrixMarketShardSet& set, std::ptrdiff_t n, int p)
+{
+  std::ptrdiff_t n_shards = set.getNShards();
+  std::ptrdiff_t total = 0;
+  for (std::ptrdiff_t i = 0; i < n_shards; ++i) {
+    total += set.shard(i).getBytes().size();
+  }
+
+  // Number the chunks of each shard, proportional to its size.
+  std::vector<std::ptrdiff_t> starts(n_shards + 1);
+  for (std::ptrdiff_t i = 0; i < n_shards; ++i) {
+    std::ptrdiff_t bytes = set.shard(i).getBytes().size();
+    starts[i + 1] = starts[i] + std::max<std::ptrdiff_t>(1, (n * bytes) / std::max<std::ptrdiff_t>(1, total));
+  }
+
+  std::vector<shard_chunk> chunks(starts.back() + 1);
+  std::atomic<std::ptrdiff_t> next = 0;
+  parallel(std::min<std::ptrdiff_t>(p, n_shards), [&](int) {
+    for (std::ptrdiff_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n_shards; ) {
+      edge_partition parts = partition_edges(set.shard(i), starts[i + 1] - starts[i], 1);
+      for (std::ptrdiff_t t = 0; t < parts.size(); ++t) {
+        chunks[starts[i] + t] = {
+          .shard = i,
+          .begin = parts.bounds[t],
+          .end = parts.bounds[t + 1],
+          .first = parts.offsets[t + 1] - parts.offsets[t]
+        };
+      }
+    }
+  });
+
+  // Turn the per-chunk edge counts into global ordinals.
+  std::ptrdiff_t first = 0;
+  for (auto& chunk : chunks) {
+    std::ptrdiff_t count = chunk.first;
+    chunk.first = first;
+    first += count;
+  }
+  return chunks;
+}
+
+/// Partition the shards of `set` into about `4 * p` chunks.
+inline static std::vector<shard_chunk>
+partition_shards(const MatrixMarketShardSet& set, int p = default_threads())
+{
+  return partition_shards(set, 4 * p, p);
+}
+
+/// Load the entries of every shard in `set` into one COO matrix, in parallel.
+///
+/// Threads claim chunks dynamically, so shards of uneven size balance, and
+/// each entry lands in the slot of its global ordinal. Symmetric sets are
+/// stored according to `s`.
+template <class I = std::int32_t, class V = double>
+inline static coo<I, V>
+build_coo(const MatrixMarketShardSet& set, symmetric_storage s, int p = default_threads())
+{
+  std::vector<shard_chunk> chunks = partition_shards(set, p);
+  std::ptrdiff_t n_chunks = chunks.size() - 1;
+
+  coo<I, V> A;
+  A.n_rows = set.getNRows();
+  A.n_cols = set.getNCols();
+  A.rows.resize(chunks.back().first);
+  A.cols.resize(chunks.back().first);
+  A.values.resize(chunks.back().first);
+
+  std::atomic<std::ptrdiff_t> next = 0;
+  bool pattern = set.isPattern();
+  parallel(p, [&](int) {
+    for (std::ptrdiff_t c; (c = next.fetch_add(1, std::memory_order_relaxed)) < n_chunks; ) {
+      std::ptrdiff_t k = chunks[c].first;
+      if (pattern) {
+        for (auto&& [u, v] : chunks[c].range()) {
+          A.rows[k] = u;
+          A.cols[k] = v;
+          A.values[k] = V(1);
+          ++k;
+        }
+      }
+      else {
+        for (auto&& [u, v, w] : chunks[c].range<V>()) {
+          A.rows[k] = u;
+          A.cols[k] = v;
+          A.values[k] = w;
+          ++k;
+        }
+      }
+    }
+  });
+
+  if (!set.isGeneral()) {
+    expand_symmetric(A, s, set.isSkew(), p);
+  }
+  return A;
+}
+
+/// Load the entries of every shard in `set` into a CSR matrix, in parallel.
+template <class I = std::int32_t, class V = double>
+inline static csr<I, V>
+build_csr(const MatrixMarketShardSet& set,
+          symmetric_storage s = symmetric_storage::full,
+          int p = default_threads())
+{
+  return to_csr(build_coo<I, V>(set, s, p), p);
+}
+
+/// Load the entries of every shard in `set` into a CSC matrix, in parallel.
+template <class I = std::int32_t, class V = double>
+inline static csc<I, V>
+build_csc(const MatrixMarketShardSet& set,
+          symmetric_storage s = symmetric_storage::full,
+          int p = default_threads())
+{
+  return to_csc(build_coo<I, V>(set, s, p), p);
+}
+}
@@ -0,0 +1,232 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/builders.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The Arrow C data interface ABI, as published in the Arrow specification.
+// It is guarded so that it can coexist with Arrow's own copy of it.
+extern "C" {
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+}
+
+namespace mmio
+{
+/// The Arrow format string of a primitive index or value type.
+template <class T>
+constexpr const char*
+arrow_format()
+{
+  if constexpr (std::is_same_v<T, std::int8_t>)        return "c";
+  else if constexpr (std::is_same_v<T, std::uint8_t>)  return "C";
+  else if constexpr (std::is_same_v<T, std::int16_t>)  return "s";
+  else if constexpr (std::is_same_v<T, std::uint16_t>) return "S";
+  else if constexpr (std::is_same_v<T, std::int32_t>)  return "i";
+  else if constexpr (std::is_same_v<T, std::uint32_t>) return "I";
+  else if constexpr (std::is_same_v<T, std::int64_t>)  return "l";
+  else if constexpr (std::is_same_v<T, std::uint64_t>) return "L";
+  else if constexpr (std::is_same_v<T, float>)         return "f";
+  else if constexpr (std::is_same_v<T, double>)        return "g";
+  else static_assert(!sizeof(T), "type has no Arrow equivalent");
+}
+
+/// The description of an exported Arrow field, its type, and its children.
+struct arrow_field
+{
+  std::string format = {};
+  std::string name = {};
+  std::string metadata = {};                    // encoded with `arrow_metadata`
+  std::vector<arrow_field> children = {};
+};
+
+/// The buffers of an exported Arrow array and its children.
+///
+/// The buffers are borrowed from an owner that `export_arrow_array` keeps
+/// alive until the last exported array using it is released.
+struct arrow_node
+{
+  std::int64_t length = 0;
+  std::vector<const void*> buffers = {};        // validity first, always null
+  std::vector<arrow_node> children = {};
+};
+
+/// Encode key-value pairs in the binary layout of `ArrowSchema::metadata`.
+std::string arrow_metadata(const std::vector<std::pair<std::string, std::string>>& pairs);
+
+/// Fill `out` from `field`, with a release callback that frees the copies of
+/// its strings.
+void export_arrow_schema(const arrow_field& field, ArrowSchema* out);
+
+/// Fill `out` from `node`, with release callbacks that share ownership of
+/// `owner`.
+///
+/// Every array and child holds its own reference, so consumers may move
+/// children out and release them independently, as the interface allows.
+void export_arrow_array(const arrow_node& node, std::shared_ptr<const void> owner, ArrowArray* out);
+
+/// Export a COO matrix as an Arrow struct array of `row`, `col`, and `value`
+/// without copying.
+///
+/// The matrix is moved into storage owned by the exported array and freed by
+/// its release callback. The schema's metadata carries `mmio.n_rows` and
+/// `mmio.n_cols`.
+template <class I, class V>
+inline static void
+export_arrow(coo<I, V>&& A, ArrowArray* array, ArrowSchema* schema)
+{
+  auto owner = std::make_shared<const coo<I, V>>(std::move(A));
+
+  export_arrow_schema({
+      .format = "+s",
+      .metadata = arrow_metadata({
+          { "mmio.n_rows", std::to_string(owner->n_rows) },
+          { "mmio.n_cols", std::to_string(owner->n_cols) } }),
+      .children = {
+        { .format = arrow_format<I>(), .name = "row" },
+        { .format = arrow_format<I>(), .name = "col" },
+        { .format = arrow_format<V>(), .name = "value" } }
+    }, schema);
+
+  std::int64_t n = owner->nnz();
+  arrow_node node = {
+    .length = n,
+    .buffers = { nullptr },
+    .children = {
+      { .length = n, .buffers = { nullptr, owner->rows.data() } },
+      { .length = n, .buffers = { nullptr, owner->cols.data() } },
+      { .length = n, .buffers = { nullptr, owner->values.data() } } }
+  };
+  export_arrow_array(node, std::move(owner), array);
+}
+
+/// Export the arrays of a compressed matrix as an Arrow list array with one
+/// list of (`index`, `value`) structs per major slot, without copying.
+///
+/// The compressed offsets are the list offsets, so `I` must be a 32-bit
+/// (`+l`) or 64-bit (`+L`) signed integer. `name` names the minor index.
+template <class Matrix>
+inline static void
+export_arrow_compressed(Matrix&& A, const char* name, ArrowArray* array, ArrowSchema* schema)
+{
+  using I = typename std::decay_t<Matrix>::index_type;
+  using V = typename std::decay_t<Matrix>::value_type;
+  static_assert(std::is_same_v<I, std::int32_t> || std::is_same_v<I, std::int64_t>,
+                "Arrow list offsets must be int32 or int64");
+
+  auto owner = std::make_shared<const std::decay_t<Matrix>>(std::move(A));
+
+  export_arrow_schema({
+      .format = (std::is_same_v<I, std::int32_t>) ? "+l" : "+L",
+      .metadata = arrow_metadata({
+          { "mmio.n_rows", std::to_string(owner->n_rows) },
+          { "mmio.n_cols", std::to_string(owner->n_cols) } }),
+      .children = {
+        { .format = "+s", .name = "entry", .children = {
+            { .format = arrow_format<I>(), .name = name },
+            { .format = arrow_format<V>(), .name = "value" } } } }
+    }, schema);
+
+  std::int64_t n = owner->nnz();
+  arrow_node node = {
+    .length = std::int64_t(owner->offsets.size()) - 1,
+    .buffers = { nullptr, owner->offsets.data() },
+    .children = {
+      { .length = n, .buffers = { nullptr }, .children = {
+          { .length = n, .buffers = { nullptr, owner->indices.data() } },
+          { .length = n, .buffers = { nullptr, owner->values.data() } } } } }
+  };
+  export_arrow_array(node, std::move(owner), array);
+}
+
+/// Export a CSR matrix as an Arrow list array of rows, each a list of
+/// (`col`, `value`) structs, without copying.
+template <class I, class V>
+inline static void
+export_arrow(csr<I, V>&& A, ArrowArray* array, ArrowSchema* schema)
+{
+  export_arrow_compressed(std::move(A), "col", array, schema);
+}
+
+/// Export a CSC matrix as an Arrow list array of columns, each a list of
+/// (`row`, `value`) structs, without copying.
+template <class I, class V>
+inline static void
+export_arrow(csc<I, V>&& A, ArrowArray* array, ArrowSchema* schema)
+{
+  export_arrow_compressed(std::move(A), "row", array, schema);
+}
+}
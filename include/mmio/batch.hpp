@@ -0,0 +1,210 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace mmio
+{
+/// The header of a small .mtx file read by `read_small_mtx`.
+struct small_mtx
+{
+  char typecode[4] = {};
+  std::int32_t n_rows = 0;
+  std::int32_t n_cols = 0;
+  std::int32_t nnz = 0;
+  const char* begin = nullptr;                  // first edge, in the buffer
+  const char*   end = nullptr;
+
+  template <class... Vs>
+  MatrixMarketFile::edge_range<Vs...> edges() const {
+    return { begin, end };
+  }
+};
+
+/// Read all of `path` into `buffer` with a single `pread` and parse its
+/// header in memory.
+///
+/// This avoids the `fdopen`, `mmap`, and `munmap` calls of a
+/// `MatrixMarketFile`, which dominate the load time of small files. The
+/// returned edges point into `buffer`, which is reused across calls.
+small_mtx read_small_mtx(const std::filesystem::path& path, std::string& buffer);
+
+/// Many small COO matrices packed into one arena.
+///
+/// Matrix `i` owns entries `[offsets[i], offsets[i + 1])` of the shared
+/// `rows`, `cols`, and `values` arrays.
+template <class I = std::int32_t, class V = double>
+struct coo_batch
+{
+  struct view
+  {
+    std::int32_t n_rows;
+    std::int32_t n_cols;
+    std::span<const I> rows;
+    std::span<const I> cols;
+    std::span<const V> values;
+
+    std::ptrdiff_t nnz() const {
+      return rows.size();
+    }
+  };
+
+  std::vector<std::int32_t>  n_rows;
+  std::vector<std::int32_t>  n_cols;
+  std::vector<std::ptrdiff_t> offsets;
+  std::vector<I>               rows;
+  std::vector<I>               cols;
+  std::vector<V>             values;
+
+  std::ptrdiff_t size() const {
+    return n_rows.size();
+  }
+
+  view operator[](std::ptrdiff_t i) const {
+    std::ptrdiff_t k = offsets[i], n = offsets[i + 1] - k;
+    return {
+      .n_rows = n_rows[i],
+      .n_cols = n_cols[i],
+      .rows   = { rows.data() + k, std::size_t(n) },
+      .cols   = { cols.data() + k, std::size_t(n) },
+      .values = { values.data() + k, std::size_t(n) }
+    };
+  }
+};
+
+/// Load many small .mtx files into a `coo_batch`, in parallel across files.
+///
+/// Threads claim files dynamically, read each with `read_small_mtx`, and
+/// parse it into thread-local scratch arrays, applying the symmetric
+/// storage `s` per matrix. The scratch entries are then copied into the
+/// arena in parallel, so the result holds three allocations no matter how
+/// many files there are.
+template <class I = std::int32_t, class V = double>
+inline static coo_batch<I, V>
+load_batch(const std::vector<std::filesystem::path>& paths,
+           symmetric_storage s = symmetric_storage::full,
+           int p = default_threads())
+{
+  std::ptrdiff_t n = paths.size();
+  p = std::max<std::ptrdiff_t>(1, std::min<std::ptrdiff_t>(p, n));
+
+  struct scratch
+  {
+    std::vector<I> rows;
+    std::vector<I> cols;
+    std::vector<V> values;
+  };
+
+  coo_batch<I, V> batch;
+  batch.n_rows.resize(n);
+  batch.n_cols.resize(n);
+  batch.offsets.resize(n + 1);
+
+  std::vector<scratch> local(p);
+  std::vector<int> owner(n);
+  std::vector<std::ptrdiff_t> start(n);         // first entry in the owner's scratch
+  std::atomic<std::ptrdiff_t> next = 0;
+
+  parallel(p, [&](int t) {
+    std::string buffer;
+    scratch& out = local[t];
+    for (std::ptrdiff_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n; ) {
+      small_mtx mtx = read_small_mtx(paths[i], buffer);
+      bool pattern = (mtx.typecode[2] == 'P');
+      bool general = (mtx.typecode[3] == 'G');
+      bool skew = (mtx.typecode[3] == 'K');
+
+      auto add = [&](I u, I v, V w) {
+        if (!general && s == symmetric_storage::upper && v < u) {
+          std::swap(u, v);
+          w = (skew) ? negate(w) : w;
+        }
+        out.rows.push_back(u);
+        out.cols.push_back(v);
+        out.values.push_back(w);
+      };
+
+      std::ptrdiff_t first = out.rows.size();
+      if (pattern) {
+        for (auto&& [u, v] : mtx.edges()) {
+          add(u, v, V(1));
+        }
+      }
+      else {
+        for (auto&& [u, v, w] : mtx.edges<V>()) {
+          add(u, v, w);
+        }
+      }
+      if (!general && s == symmetric_storage::full) {
+        for (std::ptrdiff_t k = first, e = out.rows.size(); k < e; ++k) {
+          if (out.rows[k] != out.cols[k]) {
+            out.rows.push_back(out.cols[k]);
+            out.cols.push_back(out.rows[k]);
+            out.values.push_back((skew) ? negate(out.values[k]) : out.values[k]);
+          }
+        }
+      }
+
+      batch.n_rows[i] = mtx.n_rows;
+      batch.n_cols[i] = mtx.n_cols;
+      batch.offsets[i + 1] = out.rows.size() - first;
+      owner[i] = t;
+      start[i] = first;
+    }
+  });
+
+  prefix_sum(batch.offsets.begin(), batch.offsets.end(), 1);
+  batch.rows.resize(batch.offsets.back());
+  batch.cols.resize(batch.offsets.back());
+  batch.values.resize(batch.offsets.back());
+
+  parallel_for(n, p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (; i < e; ++i) {
+      const scratch& in = local[owner[i]];
+      std::ptrdiff_t k = batch.offsets[i], m = batch.offsets[i + 1] - k;
+      std::copy_n(in.rows.begin() + start[i], m, batch.rows.begin() + k);
+      std::copy_n(in.cols.begin() + start[i], m, batch.cols.begin() + k);
+      std::copy_n(in.values.begin() + start[i], m, batch.values.begin() + k);
+    }
+  });
+  return batch;
+}
+}
@@ -0,0 +1,318 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+#include "mmio/writers.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace mmio
+{
+/// The layout of the arrays in a binary file.
+enum class binary_layout : std::uint8_t
+{
+  coo = 0,                                      // rows, cols, values
+  csr = 1                                       // offsets, indices, values
+};
+
+/// The fixed-size header at the start of a binary file.
+///
+/// Two layouts share this format. The `coo` binary cache holds the entries
+/// exactly as stored in the .mtx file, with its typecode, so symmetric files
+/// stay compact and are expanded on load. The `csr` binary holds a built CSR
+/// matrix in full storage. The arrays follow the header in layout order,
+/// each starting at a 64-byte aligned offset.
+struct binary_header
+{
+  char         magic[8] = { 'M', 'M', 'I', 'O', 'B', 'I', 'N', '\0' };
+  std::uint32_t version = 1;
+  char      typecode[4] = { 'M', 'C', 'R', 'G' };
+  binary_layout  layout = binary_layout::coo;
+  std::uint8_t index_size = 0;
+  std::uint8_t value_size = 0;
+  char       value_kind = 0;                    // 'f'loat, 'i'nt, 'u'nsigned, 'o'ther
+  std::uint32_t reserved = 0;
+  std::int64_t   n_rows = 0;
+  std::int64_t   n_cols = 0;
+  std::int64_t      nnz = 0;
+
+  /// The byte offset of each of the three arrays.
+  std::int64_t array(int i) const;
+};
+
+static_assert(sizeof(binary_header) == 48);
+
+/// Open `path` for reading, returning its file descriptor.
+int open_input(const std::filesystem::path& path);
+
+/// Read `[data, data + n)` from byte `offset` of `fd`.
+void pread_all(int fd, char* data, std::size_t n, std::ptrdiff_t offset);
+
+/// Close a file descriptor returned by `open_input`.
+void close_input(int fd);
+
+/// Read and validate the header of the binary file `fd`.
+binary_header read_binary_header(int fd);
+
+/// Read and validate the header of the binary file at `path`.
+binary_header read_binary_header(const std::filesystem::path& path);
+
+template <class V>
+inline static constexpr char
+value_kind()
+{
+  if constexpr (std::is_floating_point_v<V>) {
+    return 'f';
+  }
+  else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>) {
+    return 'i';
+  }
+  else if constexpr (std::is_integral_v<V>) {
+    return 'u';
+  }
+  else {
+    return 'o';
+  }
+}
+
+/// Create a header for a binary file with index type `I` and value type `V`.
+///
+/// Binary files hold one value per entry, so complex typecodes are rejected.
+template <class I, class V>
+inline static binary_header
+make_binary_header(binary_layout layout, std::string_view typecode,
+                   std::int64_t n_rows, std::int64_t n_cols, std::int64_t nnz)
+{
+  if (typecode[2] == 'C') {
+    fprintf(stderr, "binary file failed: complex values are not supported\n");
+    std::exit(EXIT_FAILURE);
+  }
+
+  binary_header h;
+  std::memcpy(h.typecode, typecode.data(), sizeof(h.typecode));
+  h.layout = layout;
+  h.index_size = sizeof(I);
+  h.value_size = sizeof(V);
+  h.value_kind = value_kind<V>();
+  h.n_rows = n_rows;
+  h.n_cols = n_cols;
+  h.nnz = nnz;
+  return h;
+}
+
+/// Check that a header matches the expected layout and types.
+template <class I, class V>
+inline static void
+check_binary_header(const binary_header& h, binary_layout layout)
+{
+  if (h.layout != layout || h.index_size != sizeof(I) ||
+      h.value_size != sizeof(V) || h.value_kind != value_kind<V>()) {
+    fprintf(stderr, "binary file layout or types do not match\n");
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+/// Write `n` elements at byte `offset` of `fd`, in parallel blocks.
+template <class T>
+inline static void
+write_array(int fd, const T* data, std::ptrdiff_t n, std::ptrdiff_t offset, int p)
+{
+  parallel_for(n, p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    pwrite_all(fd, reinterpret_cast<const char*>(data + i), (e - i) * sizeof(T), offset + i * sizeof(T));
+  });
+}
+
+/// Read `n` elements from byte `offset` of `fd`, in parallel blocks.
+template <class T>
+inline static void
+read_array(int fd, T* data, std::ptrdiff_t n, std::ptrdiff_t offset, int p)
+{
+  parallel_for(n, p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    pread_all(fd, reinterpret_cast<char*>(data + i), (e - i) * sizeof(T), offset + i * sizeof(T));
+  });
+}
+
+/// Write three arrays after `h` into a new binary file at `path`.
+template <class A, class B, class C>
+inline static void
+write_binary(const std::filesystem::path& path, const binary_header& h,
+             const std::vector<A>& a, const std::vector<B>& b, const std::vector<C>& c,
+             int p)
+{
+  int fd = open_output(path);
+  pwrite_all(fd, reinterpret_cast<const char*>(&h), sizeof(h), 0);
+  write_array(fd, a.data(), a.size(), h.array(0), p);
+  write_array(fd, b.data(), b.size(), h.array(1), p);
+  write_array(fd, c.data(), c.size(), h.array(2), p);
+  close_output(fd);
+}
+
+/// Write a COO matrix to a binary cache, recording its `typecode`.
+///
+/// The entries should be stored as in the file (`symmetric_storage::stored`)
+/// for a symmetric typecode, as `read_coo` expands them again.
+template <class I, class V>
+inline static void
+write_binary(const std::filesystem::path& path, const coo<I, V>& A,
+             std::string_view typecode = "MCRG", int p = default_threads())
+{
+  auto h = make_binary_header<I, V>(binary_layout::coo, typecode, A.n_rows, A.n_cols, A.nnz());
+  write_binary(path, h, A.rows, A.cols, A.values, p);
+}
+
+/// Write a full-storage CSR matrix to a CSR binary, recording its `typecode`.
+template <class I, class V>
+inline static void
+write_binary(const std::filesystem::path& path, const csr<I, V>& A,
+             std::string_view typecode = "MCRG", int p = default_threads())
+{
+  auto h = make_binary_header<I, V>(binary_layout::csr, typecode, A.n_rows, A.n_cols, A.nnz());
+  write_binary(path, h, A.offsets, A.indices, A.values, p);
+}
+
+/// Read a COO binary cache, storing symmetric matrices according to `s`.
+template <class I = std::int32_t, class V = double>
+inline static coo<I, V>
+read_coo(const std::filesystem::path& path,
+         symmetric_storage s = symmetric_storage::full,
+         int p = default_threads())
+{
+  int fd = open_input(path);
+  binary_header h = read_binary_header(fd);
+  check_binary_header<I, V>(h, binary_layout::coo);
+
+  coo<I, V> A;
+  A.n_rows = h.n_rows;
+  A.n_cols = h.n_cols;
+  A.rows.resize(h.nnz);
+  A.cols.resize(h.nnz);
+  A.values.resize(h.nnz);
+  read_array(fd, A.rows.data(), h.nnz, h.array(0), p);
+  read_array(fd, A.cols.data(), h.nnz, h.array(1), p);
+  read_array(fd, A.values.data(), h.nnz, h.array(2), p);
+  close_input(fd);
+
+  if (h.typecode[3] != 'G') {
+    expand_symmetric(A, s, h.typecode[3] == 'K', p);
+  }
+  return A;
+}
+
+/// Read a CSR binary.
+template <class I = std::int32_t, class V = double>
+inline static csr<I, V>
+read_csr(const std::filesystem::path& path, int p = default_threads())
+{
+  int fd = open_input(path);
+  binary_header h = read_binary_header(fd);
+  check_binary_header<I, V>(h, binary_layout::csr);
+
+  csr<I, V> A;
+  A.n_rows = h.n_rows;
+  A.n_cols = h.n_cols;
+  A.offsets.resize(h.n_rows + 1);
+  A.indices.resize(h.nnz);
+  A.values.resize(h.nnz);
+  read_array(fd, A.offsets.data(), h.n_rows + 1, h.array(0), p);
+  read_array(fd, A.indices.data(), h.nnz, h.array(1), p);
+  read_array(fd, A.values.data(), h.nnz, h.array(2), p);
+  close_input(fd);
+  return A;
+}
+
+/// Convert `mm` into a COO binary cache at `path` without loading it whole.
+///
+/// The edges are parsed in chunks sized so that the `p` chunks in flight
+/// hold about `budget` bytes of decoded entries. Exact edge ordinals from
+/// `partition_edges` fix each chunk's place in the output arrays, so each
+/// thread parses and `pwrite`s its chunks independently.
+template <class I = std::int32_t, class V = double>
+inline static binary_header
+convert_to_binary(const MatrixMarketFile& mm, const std::filesystem::path& path,
+                  std::size_t budget, int p = default_threads())
+{
+  if (mm.isComplex()) {
+    fprintf(stderr, "convert_to_binary failed: complex values are not supported\n");
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::ptrdiff_t entry = 2 * sizeof(I) + sizeof(V);
+  std::ptrdiff_t per_chunk = std::max<std::ptrdiff_t>(1, budget / (entry * p));
+  std::ptrdiff_t n = std::max<std::ptrdiff_t>(p, (mm.getNEdges() + per_chunk - 1) / per_chunk);
+  edge_partition parts = partition_edges(mm, n, p);
+
+  auto h = make_binary_header<I, V>(binary_layout::coo, { mm.getTypecode(), 4 },
+                                    mm.getNRows(), mm.getNCols(), parts.edges());
+  int fd = open_output(path);
+  pwrite_all(fd, reinterpret_cast<const char*>(&h), sizeof(h), 0);
+
+  bool pattern = mm.isPattern();
+  parallel(p, [&](int t) {
+    std::vector<I> rows, cols;
+    std::vector<V> values;
+    for (std::ptrdiff_t c = t; c < n; c += p) {
+      rows.clear();
+      cols.clear();
+      values.clear();
+      if (pattern) {
+        for (auto&& [u, v] : parts.range(c)) {
+          rows.push_back(u);
+          cols.push_back(v);
+          values.push_back(V(1));
+        }
+      }
+      else {
+        for (auto&& [u, v, w] : parts.range<V>(c)) {
+          rows.push_back(u);
+          cols.push_back(v);
+          values.push_back(w);
+        }
+      }
+      std::ptrdiff_t k = parts.offsets[c];
+      write_array(fd, rows.data(), rows.size(), h.array(0) + k * sizeof(I), 1);
+      write_array(fd, cols.data(), cols.size(), h.array(1) + k * sizeof(I), 1);
+      write_array(fd, values.data(), values.size(), h.array(2) + k * sizeof(V), 1);
+    }
+  });
+  close_output(fd);
+  return h;
+}
+}
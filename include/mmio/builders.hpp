@@ -0,0 +1,892 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/hash.hpp"
+#include "mmio/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mmio
+{
+/// A partition of the edges in an .mmio file into `p` contiguous chunks.
+///
+/// `MatrixMarketFile::edge()` only approximates the nth edge, so the chunk
+/// boundaries come from `edge()` and the exact ordinal of each chunk's first
+/// edge is recovered by counting lines. This lets parallel builders write
+/// each edge directly into its final slot.
+struct edge_partition
+{
+  std::vector<const char*>     bounds;          // p + 1 line-aligned pointers
+  std::vector<std::ptrdiff_t> offsets;          // p + 1 edge ordinals
+
+  std::ptrdiff_t size() const {
+    return bounds.size() - 1;
+  }
+
+  /// The total number of edges in the partition.
+  std::ptrdiff_t edges() const {
+    return offsets.back();
+  }
+
+  template <class... Vs>
+  MatrixMarketFile::edge_range<Vs...> range(std::ptrdiff_t t) const {
+    return {
+      .begin_ = bounds[t],
+      .end_   = bounds[t + 1]
+    };
+  }
+};
+
+/// Count the lines in `[i, e)`, including an unterminated last line.
+inline static std::ptrdiff_t
+count_lines(const char* i, const char* e)
+{
+  std::ptrdiff_t n = 0;
+  while (i < e) {
+    ++n;
+    i = static_cast<const char*>(std::memchr(i, '\n', e - i));
+    if (i == nullptr) {
+      break;
+    }
+    ++i;
+  }
+  return n;
+}
+
+/// The first line start at or after byte `n` of `bytes`.
+inline static const char*
+line_start(std::string_view bytes, std::ptrdiff_t n)
+{
+  if (n <= 0) {
+    return bytes.data();
+  }
+  if (std::ssize(bytes) <= n) {
+    return bytes.data() + bytes.size();
+  }
+  auto i = static_cast<const char*>(std::memchr(bytes.data() + n - 1, '\n', bytes.size() - n + 1));
+  return (i) ? i + 1 : bytes.data() + bytes.size();
+}
+
+/// Partition the edges of `mm` into `n` chunks, counting lines with `p`
+/// threads.
+inline static edge_partition
+partition_edges(const MatrixMarketFile& mm, std::ptrdiff_t n, int p)
+{
+  edge_partition parts;
+  parts.bounds.resize(n + 1);
+  parts.offsets.resize(n + 1);
+  for (std::ptrdiff_t t = 0; t <= n; ++t) {
+    parts.bounds[t] = mm.edge((mm.getNEdges() * t) / n);
+  }
+
+  parallel_for(n, p, [&](int, std::ptrdiff_t t, std::ptrdiff_t e) {
+    for (; t < e; ++t) {
+      parts.offsets[t + 1] = count_lines(parts.bounds[t], parts.bounds[t + 1]);
+    }
+  });
+  prefix_sum(parts.offsets.begin(), parts.offsets.end(), 1);
+  return parts;
+}
+
+/// Partition the edges of `mm` into `p` chunks, counting lines in parallel.
+inline static edge_partition
+partition_edges(const MatrixMarketFile& mm, int p = default_threads())
+{
+  return partition_edges(mm, p, p);
+}
+
+/// How builders store the entries of symmetric, skew-symmetric, and hermitian
+/// files. General files are always stored exactly as they appear.
+///
+/// Hermitian files are treated as symmetric, as only real parts are parsed.
+enum class symmetric_storage
+{
+  stored,                                       // only the entries in the file
+  full,                                         // mirror off-diagonal entries
+  upper                                         // the upper triangle only
+};
+
+/// A coordinate (COO) matrix in structure-of-arrays form.
+///
+/// Entries are 0-based and in file order, followed by any mirrored entries.
+/// Pattern files get a value of `V(1)` for every entry.
+template <class I = std::int32_t, class V = double>
+struct coo
+{
+  using index_type = I;
+  using value_type = V;
+
+  std::int32_t n_rows = 0;
+  std::int32_t n_cols = 0;
+  std::vector<I>  rows;
+  std::vector<I>  cols;
+  std::vector<V> values;
+
+  std::ptrdiff_t nnz() const {
+    return rows.size();
+  }
+};
+
+/// A compressed sparse row (CSR) matrix.
+///
+/// Column indices are sorted within each row. Duplicate entries are kept.
+template <class I = std::int32_t, class V = double>
+struct csr
+{
+  using index_type = I;
+  using value_type = V;
+
+  std::int32_t n_rows = 0;
+  std::int32_t n_cols = 0;
+  std::vector<I> offsets;                       // n_rows + 1 row pointers
+  std::vector<I> indices;                       // column of each entry
+  std::vector<V>  values;
+
+  std::ptrdiff_t nnz() const {
+    return indices.size();
+  }
+
+  /// The first row of the `t`th of `p` row blocks with balanced nnz.
+  ///
+  /// The last block ends at `n_rows`, so it also covers any trailing empty
+  /// rows, which a search by nnz alone would leave out.
+  std::int32_t row_block_begin(int p, int t) const {
+    if (t == p) {
+      return n_rows;
+    }
+    auto i = std::lower_bound(offsets.begin(), offsets.end(),
+                              I(block_begin(nnz(), p, t)));
+    return std::min<std::int32_t>(i - offsets.begin(), n_rows);
+  }
+};
+
+/// A compressed sparse column (CSC) matrix.
+///
+/// Row indices are sorted within each column. Duplicate entries are kept.
+template <class I = std::int32_t, class V = double>
+struct csc
+{
+  using index_type = I;
+  using value_type = V;
+
+  std::int32_t n_rows = 0;
+  std::int32_t n_cols = 0;
+  std::vector<I> offsets;                       // n_cols + 1 column pointers
+  std::vector<I> indices;                       // row of each entry
+  std::vector<V>  values;
+
+  std::ptrdiff_t nnz() const {
+    return indices.size();
+  }
+};
+
+/// Sort the `n` entries of a single row by column.
+template <class I, class V>
+inline static void
+sort_row(I* indices, V* values, std::ptrdiff_t n)
+{
+  if (n < 32) {
+    for (std::ptrdiff_t i = 1; i < n; ++i) {
+      I j = indices[i];
+      V v = values[i];
+      std::ptrdiff_t k = i;
+      for (; 0 < k && j < indices[k - 1]; --k) {
+        indices[k] = indices[k - 1];
+        values[k] = values[k - 1];
+      }
+      indices[k] = j;
+      values[k] = v;
+    }
+    return;
+  }
+
+  std::vector<std::pair<I, V>> row(n);
+  for (std::ptrdiff_t i = 0; i < n; ++i) {
+    row[i] = { indices[i], values[i] };
+  }
+  std::stable_sort(row.begin(), row.end(), [](auto& a, auto& b) {
+    return a.first < b.first;
+  });
+  for (std::ptrdiff_t i = 0; i < n; ++i) {
+    std::tie(indices[i], values[i]) = row[i];
+  }
+}
+
+/// The negation of `v` for mirroring skew-symmetric entries.
+///
+/// Value types without a unary minus can still be loaded from other files.
+template <class V>
+inline static V
+negate(const V& v)
+{
+  if constexpr (requires { -v; }) {
+    return V(-v);
+  }
+  else {
+    fprintf(stderr, "skew-symmetric file needs a value type with a unary minus\n");
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+/// Apply a `symmetric_storage` choice to the stored triangle of a symmetric
+/// (or, with `skew`, skew-symmetric) matrix, in parallel.
+///
+/// `full` appends the mirror of each off-diagonal entry, so diagonal entries
+/// are never duplicated. `upper` moves each stored entry into the upper
+/// triangle in place.
+template <class I, class V>
+inline static void
+expand_symmetric(coo<I, V>& A, symmetric_storage s, bool skew, int p = default_threads())
+{
+  std::ptrdiff_t n = A.nnz();
+
+  if (s == symmetric_storage::upper) {
+    parallel_for(n, p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+      for (; i < e; ++i) {
+        if (A.cols[i] < A.rows[i]) {
+          std::swap(A.rows[i], A.cols[i]);
+          if (skew) {
+            A.values[i] = negate(A.values[i]);
+          }
+        }
+      }
+    });
+    return;
+  }
+
+  if (s != symmetric_storage::full) {
+    return;
+  }
+
+  std::vector<std::ptrdiff_t> mirrored(p + 1);
+  parallel_for(n, p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (; i < e; ++i) {
+      mirrored[t + 1] += (A.rows[i] != A.cols[i]);
+    }
+  });
+  prefix_sum(mirrored.begin(), mirrored.end(), 1);
+
+  A.rows.resize(n + mirrored[p]);
+  A.cols.resize(n + mirrored[p]);
+  A.values.resize(n + mirrored[p]);
+  parallel_for(n, p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (std::ptrdiff_t k = n + mirrored[t]; i < e; ++i) {
+      if (A.rows[i] != A.cols[i]) {
+        A.rows[k] = A.cols[i];
+        A.cols[k] = A.rows[i];
+        A.values[k] = (skew) ? negate(A.values[i]) : A.values[i];
+        ++k;
+      }
+    }
+  });
+}
+
+/// Visit the edges of chunk `t` of `parts` as consecutive sub-ranges
+/// `f(begin, end)`, hashing content hash leaves along the way.
+///
+/// Each leaf that starts in the chunk's bytes (the header belongs to chunk 0)
+/// is hashed into `leaves` right before the edges that end in it are
+/// visited, while its bytes are still in cache. With empty `leaves` the
+/// whole chunk is visited at once.
+template <class F>
+inline static void
+visit_hashed(const MatrixMarketFile& mm, const edge_partition& parts, std::ptrdiff_t t,
+             std::vector<std::uint64_t>& leaves, F&& f)
+{
+  const char* i = parts.bounds[t];
+  const char* e = parts.bounds[t + 1];
+  if (leaves.empty()) {
+    f(i, e);
+    return;
+  }
+
+  std::string_view bytes = mm.getBytes();
+  std::ptrdiff_t lo = (t == 0) ? 0 : i - bytes.data();
+  std::ptrdiff_t hi = e - bytes.data();
+  for (std::ptrdiff_t j = (lo + hash_leaf_bytes - 1) / hash_leaf_bytes; j * hash_leaf_bytes < hi; ++j) {
+    leaves[j] = hash_leaf(bytes.data(), bytes.size(), j);
+    const char* next = std::clamp(line_start(bytes, (j + 1) * hash_leaf_bytes), i, e);
+    f(i, next);
+    i = next;
+  }
+  f(i, e);
+}
+
+/// Parse the entries of `mm` into a COO matrix, in parallel.
+///
+/// Each value is read as a `P` and stored as `convert(w)` in the same pass,
+/// so narrowed or quantized values never go through a wider intermediate
+/// array. Symmetric files are stored according to `s`. When `d` is not null
+/// it receives the file's `content_hash` and the `matrix_fingerprint` of the
+/// stored entries, both computed in the same pass. The fingerprint sees the
+/// converted values, so it only matches `fingerprint(mm)` for `V = double`.
+template <class I, class V, class P, class F>
+inline static coo<I, V>
+parse_coo(const MatrixMarketFile& mm, const F& convert, symmetric_storage s, int p,
+          digest* d = nullptr)
+{
+  edge_partition parts = partition_edges(mm, p);
+
+  coo<I, V> A;
+  A.n_rows = mm.getNRows();
+  A.n_cols = mm.getNCols();
+  A.rows.resize(parts.edges());
+  A.cols.resize(parts.edges());
+  A.values.resize(parts.edges());
+
+  std::vector<std::uint64_t> leaves((d) ? hash_leaves(mm.getBytes().size()) : 0);
+  std::vector<matrix_fingerprint> prints((d) ? p : 0);
+  bool pattern = mm.isPattern();
+  parallel(p, [&](int t) {
+    std::ptrdiff_t k = parts.offsets[t];
+    visit_hashed(mm, parts, t, leaves, [&](const char* i, const char* e) {
+      std::ptrdiff_t first = k;
+      if (pattern) {
+        V one = convert(P(1));
+        for (auto&& [u, v] : MatrixMarketFile::edge_range<>{ i, e }) {
+          A.rows[k] = u;
+          A.cols[k] = v;
+          A.values[k] = one;
+          ++k;
+        }
+      }
+      else {
+        for (auto&& [u, v, w] : MatrixMarketFile::edge_range<P>{ i, e }) {
+          A.rows[k] = u;
+          A.cols[k] = v;
+          A.values[k] = convert(w);
+          ++k;
+        }
+      }
+      if (d) {
+        prints[t].symmetry = mm.getTypecode()[3];
+        for (std::ptrdiff_t j = first; j < k; ++j) {
+          prints[t].add(A.rows[j], A.cols[j], (pattern) ? 0.0 : double(A.values[j]));
+        }
+      }
+    });
+  });
+
+  if (d) {
+    d->content = hash_root(leaves, mm.getBytes().size());
+    d->fingerprint = {
+      .n_rows = A.n_rows,
+      .n_cols = A.n_cols,
+      .symmetry = mm.getTypecode()[3]
+    };
+    for (auto& print : prints) {
+      d->fingerprint.merge(print);
+    }
+  }
+
+  if (!mm.isGeneral()) {
+    expand_symmetric(A, s, mm.isSkew(), p);
+  }
+  return A;
+}
+
+/// Load the entries of `mm` into a COO matrix, in parallel.
+///
+/// Values are parsed directly as `V`, which may be any type with a
+/// `value_parser`, including `bfloat16`, `fixed`, and user types.
+/// Symmetric files are stored according to `s`. When `d` is not null it
+/// receives the file's digests, computed during the parse.
+template <class I = std::int32_t, class V = double>
+inline static coo<I, V>
+build_coo(const MatrixMarketFile& mm, symmetric_storage s, int p = default_threads(),
+          digest* d = nullptr)
+{
+  return parse_coo<I, V, V>(mm, [](V w) { return w; }, s, p, d);
+}
+
+/// The `matrix_fingerprint` of the entries in `mm`, computed in parallel
+/// without storing them.
+inline static matrix_fingerprint
+fingerprint(const MatrixMarketFile& mm, int p = default_threads())
+{
+  edge_partition parts = partition_edges(mm, p);
+  std::vector<matrix_fingerprint> prints(p);
+  bool pattern = mm.isPattern();
+  parallel(p, [&](int t) {
+    prints[t].symmetry = mm.getTypecode()[3];
+    if (pattern) {
+      for (auto&& [u, v] : parts.range(t)) {
+        prints[t].add(u, v, 0.0);
+      }
+    }
+    else {
+      for (auto&& [u, v, w] : parts.range<double>(t)) {
+        prints[t].add(u, v, w);
+      }
+    }
+  });
+
+  matrix_fingerprint f = {
+    .n_rows = mm.getNRows(),
+    .n_cols = mm.getNCols(),
+    .symmetry = mm.getTypecode()[3]
+  };
+  for (auto& print : prints) {
+    f.merge(print);
+  }
+  return f;
+}
+
+/// Load the entries of `mm` into a COO matrix, in parallel, storing each value
+/// as `convert(double)`, e.g., with a `quantizer`.
+template <class I = std::int32_t, class F>
+requires std::invocable<const F&, double>
+inline static coo<I, std::invoke_result_t<const F&, double>>
+build_coo(const MatrixMarketFile& mm, const F& convert,
+          symmetric_storage s = symmetric_storage::full,
+          int p = default_threads())
+{
+  return parse_coo<I, std::invoke_result_t<const F&, double>, double>(mm, convert, s, p);
+}
+
+/// Load the entries of `mm` into a COO matrix, in parallel, mirroring
+/// symmetric files into full storage.
+template <class I = std::int32_t, class V = double>
+inline static coo<I, V>
+build_coo(const MatrixMarketFile& mm, int p = default_threads())
+{
+  return build_coo<I, V>(mm, symmetric_storage::full, p);
+}
+
+/// Compress `n` major slots of coordinate entries with a parallel counting
+/// sort, the shared core of `to_csr` and `to_csc`.
+///
+/// Counts and the scatter use relaxed atomics, so the order of entries within
+/// a slot depends on scheduling until each slot is sorted by minor index at
+/// the end.
+template <class I, class V>
+inline static csr<I, V>
+compress(std::int32_t n, std::int32_t m,
+         const std::vector<I>& major,
+         const std::vector<I>& minor,
+         const std::vector<V>& values,
+         int p)
+{
+  csr<I, V> A;
+  A.n_rows = n;
+  A.n_cols = m;
+  A.offsets.resize(n + 1);
+  A.indices.resize(major.size());
+  A.values.resize(major.size());
+
+  parallel_for(major.size(), p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (; i < e; ++i) {
+      std::atomic_ref(A.offsets[major[i] + 1]).fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  prefix_sum(A.offsets.begin(), A.offsets.end(), p);
+
+  std::vector<I> cursor(A.offsets.begin(), A.offsets.end() - 1);
+  parallel_for(major.size(), p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (; i < e; ++i) {
+      I k = std::atomic_ref(cursor[major[i]]).fetch_add(1, std::memory_order_relaxed);
+      A.indices[k] = minor[i];
+      A.values[k] = values[i];
+    }
+  });
+
+  parallel(p, [&](int t) {
+    for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+      I k = A.offsets[i];
+      sort_row(&A.indices[k], &A.values[k], A.offsets[i + 1] - k);
+    }
+  });
+  return A;
+}
+
+/// Convert a COO matrix to CSR with a parallel counting sort.
+template <class I, class V>
+inline static csr<I, V>
+to_csr(const coo<I, V>& B, int p = default_threads())
+{
+  return compress(B.n_rows, B.n_cols, B.rows, B.cols, B.values, p);
+}
+
+/// Convert a COO matrix to CSC with a parallel counting sort.
+template <class I, class V>
+inline static csc<I, V>
+to_csc(const coo<I, V>& B, int p = default_threads())
+{
+  csr<I, V> T = compress(B.n_cols, B.n_rows, B.cols, B.rows, B.values, p);
+  csc<I, V> A;
+  A.n_rows = B.n_rows;
+  A.n_cols = B.n_cols;
+  A.offsets = std::move(T.offsets);
+  A.indices = std::move(T.indices);
+  A.values = std::move(T.values);
+  return A;
+}
+
+/// The transpose of a CSR matrix, with a parallel counting sort over its
+/// columns.
+///
+/// This builds the in-edge graph of an out-edge graph without going back to
+/// COO. As in `compress`, each row is sorted at the end.
+template <class I, class V>
+inline static csr<I, V>
+transpose(const csr<I, V>& A, int p = default_threads())
+{
+  csr<I, V> T;
+  T.n_rows = A.n_cols;
+  T.n_cols = A.n_rows;
+  T.offsets.resize(A.n_cols + 1);
+  T.indices.resize(A.nnz());
+  T.values.resize(A.nnz());
+
+  parallel_for(A.nnz(), p, [&](int, std::ptrdiff_t k, std::ptrdiff_t e) {
+    for (; k < e; ++k) {
+      std::atomic_ref(T.offsets[A.indices[k] + 1]).fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  prefix_sum(T.offsets.begin(), T.offsets.end(), p);
+
+  std::vector<I> cursor(T.offsets.begin(), T.offsets.end() - 1);
+  parallel(p, [&](int t) {
+    for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+      for (I k = A.offsets[i]; k < A.offsets[i + 1]; ++k) {
+        I j = std::atomic_ref(cursor[A.indices[k]]).fetch_add(1, std::memory_order_relaxed);
+        T.indices[j] = i;
+        T.values[j] = A.values[k];
+      }
+    }
+  });
+
+  parallel(p, [&](int t) {
+    for (std::int32_t i = T.row_block_begin(p, t), e = T.row_block_begin(p, t + 1); i < e; ++i) {
+      I k = T.offsets[i];
+      sort_row(&T.indices[k], &T.values[k], T.offsets[i + 1] - k);
+    }
+  });
+  return T;
+}
+
+/// Load the entries of `mm` into a CSC matrix, in parallel.
+///
+/// Symmetric files are stored according to `s`.
+template <class I = std::int32_t, class V = double>
+inline static csc<I, V>
+build_csc(const MatrixMarketFile& mm, symmetric_storage s = symmetric_storage::full,
+          int p = default_threads())
+{
+  return to_csc(build_coo<I, V>(mm, s, p), p);
+}
+
+/// Parse a row-sorted file straight into CSR in a single pass, storing each
+/// value as `convert(P)`.
+///
+/// Each thread parses one chunk of `parts` into the same slots that a COO
+/// parse would use, which for a row-sorted file are already the CSR slots,
+/// and writes the row offsets of the rows that start inside its chunk as it
+/// goes. The offsets of rows that start at chunk boundaries, or that are
+/// empty, are filled in afterward. Every write is sequential, with no
+/// counting pass and no scatter. A row that is out of order stops all the
+/// threads early and returns false, leaving `A` unspecified. Rows whose
+/// columns are out of order are sorted at the end.
+template <class I, class V, class P, class F>
+inline static bool
+parse_sorted_csr(const MatrixMarketFile& mm, const F& convert, csr<I, V>& A, int p)
+{
+  edge_partition parts = partition_edges(mm, p);
+  A.n_rows = mm.getNRows();
+  A.n_cols = mm.getNCols();
+  A.offsets.resize(A.n_rows + 1);
+  A.indices.resize(parts.edges());
+  A.values.resize(parts.edges());
+
+  struct chunk
+  {
+    std::int32_t first_row = -1, last_row = -1;
+    std::int32_t first_col = -1, last_col = -1;
+    bool sorted_cols = true;
+  };
+
+  std::vector<chunk> chunks(p);
+  std::atomic<bool> unsorted = false;
+  bool pattern = mm.isPattern();
+  parallel(p, [&](int t) {
+    chunk& c = chunks[t];
+    std::ptrdiff_t k = parts.offsets[t];
+    auto add = [&](std::int32_t u, std::int32_t v, V w) {
+      if (c.first_row < 0) {
+        c.first_row = u;
+        c.first_col = v;
+      }
+      else if (u < c.last_row) {
+        return false;
+      }
+      else if (u == c.last_row) {
+        c.sorted_cols &= (c.last_col <= v);
+      }
+      else {
+        // Chunks of an unsorted file may write the same rows before they
+        // notice, so these stores are atomic even though the result is then
+        // discarded.
+        for (std::int32_t r = c.last_row + 1; r <= u; ++r) {
+          std::atomic_ref(A.offsets[r]).store(I(k), std::memory_order_relaxed);
+        }
+      }
+      c.last_row = u;
+      c.last_col = v;
+      A.indices[k] = v;
+      A.values[k] = w;
+      return (++k & 1023) || !unsorted.load(std::memory_order_relaxed);
+    };
+
+    bool ok = true;
+    if (pattern) {
+      V one = convert(P(1));
+      for (auto&& [u, v] : parts.range(t)) {
+        if (!(ok = add(u, v, one))) {
+          break;
+        }
+      }
+    }
+    else {
+      for (auto&& [u, v, w] : parts.range<P>(t)) {
+        if (!(ok = add(u, v, convert(w)))) {
+          break;
+        }
+      }
+    }
+    if (!ok) {
+      unsorted.store(true, std::memory_order_relaxed);
+    }
+  });
+  if (unsorted) {
+    return false;
+  }
+
+  // Check the order across chunks and fill in the offsets of rows that start
+  // at a chunk boundary or are empty.
+  bool sorted_cols = true;
+  std::int32_t last_row = -1, last_col = -1;
+  for (int t = 0; t < p; ++t) {
+    const chunk& c = chunks[t];
+    if (c.first_row < 0) {
+      continue;
+    }
+    if (c.first_row < last_row) {
+      return false;
+    }
+    sorted_cols &= c.sorted_cols && (c.first_row != last_row || last_col <= c.first_col);
+    for (std::int32_t r = last_row + 1; r <= c.first_row; ++r) {
+      A.offsets[r] = parts.offsets[t];
+    }
+    last_row = c.last_row;
+    last_col = c.last_col;
+  }
+  for (std::int32_t r = last_row + 1; r <= A.n_rows; ++r) {
+    A.offsets[r] = parts.edges();
+  }
+
+  if (!sorted_cols) {
+    parallel(p, [&](int t) {
+      for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+        I k = A.offsets[i];
+        sort_row(&A.indices[k], &A.values[k], A.offsets[i + 1] - k);
+      }
+    });
+  }
+  return true;
+}
+
+/// Load the entries of `mm` into a CSR matrix, in parallel.
+///
+/// Symmetric files are stored according to `s`. Row-sorted files that need
+/// no mirroring take the single-pass `parse_sorted_csr` path.
+template <class I = std::int32_t, class V = double>
+inline static csr<I, V>
+build_csr(const MatrixMarketFile& mm, symmetric_storage s, int p = default_threads())
+{
+  csr<I, V> A;
+  if ((mm.isGeneral() || s == symmetric_storage::stored) &&
+      parse_sorted_csr<I, V, V>(mm, [](V w) { return w; }, A, p)) {
+    return A;
+  }
+  return to_csr(build_coo<I, V>(mm, s, p), p);
+}
+
+/// Load the entries of `mm` into a CSR matrix, in parallel, storing each value
+/// as `convert(double)`.
+template <class I = std::int32_t, class F>
+requires std::invocable<const F&, double>
+inline static csr<I, std::invoke_result_t<const F&, double>>
+build_csr(const MatrixMarketFile& mm, const F& convert,
+          symmetric_storage s = symmetric_storage::full,
+          int p = default_threads())
+{
+  using V = std::invoke_result_t<const F&, double>;
+  csr<I, V> A;
+  if ((mm.isGeneral() || s == symmetric_storage::stored) &&
+      parse_sorted_csr<I, V, double>(mm, convert, A, p)) {
+    return A;
+  }
+  return to_csr(build_coo<I>(mm, convert, s, p), p);
+}
+
+/// Load the entries of `mm` into a CSR matrix, in parallel, mirroring
+/// symmetric files into full storage.
+template <class I = std::int32_t, class V = double>
+inline static csr<I, V>
+build_csr(const MatrixMarketFile& mm, int p = default_threads())
+{
+  return build_csr<I, V>(mm, symmetric_storage::full, p);
+}
+
+/// A CSR matrix whose column indices are compressed per block of rows.
+///
+/// Each block of `block_rows` rows subtracts a column `base` from its indices.
+/// When the remaining span fits, the block's indices are stored as 16-bit
+/// offsets in `narrow`, otherwise as 32-bit offsets in `wide`. Row offsets
+/// and values are the same as in the source `csr`.
+template <class I = std::int32_t, class V = double>
+struct blocked_csr
+{
+  using index_type = I;
+  using value_type = V;
+
+  struct block
+  {
+    std::int32_t  base = 0;                     // column base of the block
+    bool          wide = false;                 // indices are in `wide`
+    std::ptrdiff_t start = 0;                   // first index in its array
+  };
+
+  std::int32_t n_rows = 0;
+  std::int32_t n_cols = 0;
+  std::int32_t block_rows = 0;
+  std::vector<I> offsets;                       // n_rows + 1 row pointers
+  std::vector<block> blocks;
+  std::vector<std::uint16_t> narrow;
+  std::vector<std::uint32_t>   wide;
+  std::vector<V> values;
+
+  std::ptrdiff_t nnz() const {
+    return values.size();
+  }
+
+  /// The number of bytes used by column indices.
+  std::ptrdiff_t index_bytes() const {
+    return narrow.size() * sizeof(std::uint16_t) + wide.size() * sizeof(std::uint32_t);
+  }
+
+  /// The first block of the `t`th of `p` block ranges with balanced nnz.
+  ///
+  /// The last range ends at the last block, so it also covers blocks of
+  /// trailing empty rows.
+  std::ptrdiff_t block_begin(int p, int t) const {
+    if (t == p) {
+      return blocks.size();
+    }
+    auto i = std::lower_bound(offsets.begin(), offsets.end(),
+                              I(mmio::block_begin(nnz(), p, t)));
+    std::ptrdiff_t row = std::min<std::ptrdiff_t>(i - offsets.begin(), n_rows);
+    return (row + block_rows - 1) / block_rows;
+  }
+};
+
+/// Compress the column indices of `A` into 16- or 32-bit offsets per block of
+/// `block_rows` rows, in parallel.
+template <class I, class V>
+inline static blocked_csr<I, V>
+compress_indices(const csr<I, V>& A, std::int32_t block_rows = 1024, int p = default_threads())
+{
+  using block = typename blocked_csr<I, V>::block;
+
+  blocked_csr<I, V> B;
+  B.n_rows = A.n_rows;
+  B.n_cols = A.n_cols;
+  B.block_rows = block_rows;
+  B.offsets = A.offsets;
+  B.values = A.values;
+
+  std::ptrdiff_t n_blocks = (A.n_rows + block_rows - 1) / block_rows;
+  B.blocks.resize(n_blocks);
+
+  // Find each block's column span and the space it needs in either array.
+  std::vector<std::ptrdiff_t> narrow(n_blocks + 1), wide(n_blocks + 1);
+  parallel_for(n_blocks, p, [&](int, std::ptrdiff_t b, std::ptrdiff_t e) {
+    for (; b < e; ++b) {
+      std::int32_t r = b * block_rows;
+      std::int32_t s = std::min<std::int64_t>(r + block_rows, A.n_rows);
+      I min = A.n_cols, max = 0;
+      for (I k = A.offsets[r]; k < A.offsets[s]; ++k) {
+        min = std::min(min, A.indices[k]);
+        max = std::max(max, A.indices[k]);
+      }
+      std::ptrdiff_t n = A.offsets[s] - A.offsets[r];
+      B.blocks[b].base = (n) ? min : 0;
+      B.blocks[b].wide = (n) && (std::numeric_limits<std::uint16_t>::max() < max - min);
+      (B.blocks[b].wide ? wide : narrow)[b + 1] = n;
+    }
+  });
+  prefix_sum(narrow.begin(), narrow.end(), p);
+  prefix_sum(wide.begin(), wide.end(), p);
+  B.narrow.resize(narrow.back());
+  B.wide.resize(wide.back());
+
+  parallel_for(n_blocks, p, [&](int, std::ptrdiff_t b, std::ptrdiff_t e) {
+    for (; b < e; ++b) {
+      block& blk = B.blocks[b];
+      blk.start = (blk.wide) ? wide[b] : narrow[b];
+      std::int32_t r = b * block_rows;
+      std::int32_t s = std::min<std::int64_t>(r + block_rows, A.n_rows);
+      for (I k = A.offsets[r], j = blk.start; k < A.offsets[s]; ++k, ++j) {
+        if (blk.wide) {
+          B.wide[j] = A.indices[k] - blk.base;
+        }
+        else {
+          B.narrow[j] = A.indices[k] - blk.base;
+        }
+      }
+    }
+  });
+  return B;
+}
+}
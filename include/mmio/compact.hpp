@@ -0,0 +1,139 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/id_map.hpp"
+#include "mmio/parallel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace mmio
+{
+/// A CSR matrix over the vertices that appear in a file, with the mappings
+/// between the file's vertex IDs and the dense IDs.
+///
+/// Rows and columns share one vertex space, as in a graph. Dense IDs follow
+/// the order of the original IDs, so `ids` is sorted, `ids[k]` is the 0-based
+/// file ID of dense vertex `k`, and `map.find(id)` is the dense ID of a file
+/// ID, or -1 for vertices with no entries.
+template <class I = std::int32_t, class V = double>
+struct compact_csr
+{
+  csr<I, V> A;
+  std::vector<std::int32_t> ids;                // dense ID -> file ID
+  concurrent_id_map map;                        // file ID -> dense ID
+};
+
+/// Load `mm` into CSR over only the vertices that appear in its entries.
+///
+/// This is for files that declare huge dimensions but use a sparse set of
+/// IDs. The parser threads insert every row and column ID into a lock-free
+/// `concurrent_id_map` as they parse, the distinct IDs are numbered in
+/// order, and the entries are remapped in parallel before compression, so
+/// the matrix is `k x k` for `k` distinct vertices and nothing is ever sized
+/// by `getNRows()`. Symmetric files are stored according to `s`.
+///
+/// IDs are limited to 32 bits, like the declared dimensions that
+/// `MatrixMarketFile` reads, so this exits with an error on an ID above
+/// `INT32_MAX` rather than truncating it.
+template <class I = std::int32_t, class V = double>
+inline static compact_csr<I, V>
+build_compact_csr(const MatrixMarketFile& mm,
+                  symmetric_storage s = symmetric_storage::full,
+                  int p = default_threads())
+{
+  edge_partition parts = partition_edges(mm, p);
+  std::int64_t bound = std::min<std::int64_t>(2 * parts.edges(), std::max(mm.getNRows(), mm.getNCols()));
+
+  compact_csr<I, V> C;
+  C.map = concurrent_id_map(2 * bound, p);
+
+  coo<I, V> B;
+  B.rows.resize(parts.edges());
+  B.cols.resize(parts.edges());
+  B.values.resize(parts.edges());
+
+  // IDs are parsed as 64-bit integers so that out-of-range ones are caught.
+  using tokens = MatrixMarketFile::edge_iterator<>;
+  constexpr std::int64_t max_id = std::numeric_limits<std::int32_t>::max();
+  bool pattern = mm.isPattern();
+  parallel(p, [&](int t) {
+    std::ptrdiff_t k = parts.offsets[t];
+    for (const char* i = parts.bounds[t], *e = parts.bounds[t + 1]; i < e; ++k) {
+      const char* line = i;
+      std::int64_t u = tokens::get<std::int64_t>(i);
+      std::int64_t v = tokens::get<std::int64_t>(i);
+      if (max_id < u || max_id < v) {
+        fprintf(stderr, "build_compact_csr failed: vertex ID %jd exceeds 32 bits\n",
+                std::intmax_t(std::max(u, v)));
+        std::exit(EXIT_FAILURE);
+      }
+      C.map.insert(u - 1);
+      C.map.insert(v - 1);
+      B.rows[k] = u - 1;
+      B.cols[k] = v - 1;
+      B.values[k] = (pattern) ? V(1) : tokens::get<V>(i);
+      auto nl = static_cast<const char*>(std::memchr(line, '\n', e - line));
+      i = (nl) ? nl + 1 : e;
+    }
+  });
+
+  C.ids = C.map.keys(p);
+  std::sort(C.ids.begin(), C.ids.end());
+  parallel_for(C.ids.size(), p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (; i < e; ++i) {
+      C.map.assign(C.ids[i], i);
+    }
+  });
+
+  parallel_for(B.rows.size(), p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (; i < e; ++i) {
+      B.rows[i] = C.map.find(B.rows[i]);
+      B.cols[i] = C.map.find(B.cols[i]);
+    }
+  });
+
+  B.n_rows = C.ids.size();
+  B.n_cols = C.ids.size();
+  if (!mm.isGeneral()) {
+    expand_symmetric(B, s, mm.isSkew(), p);
+  }
+  C.A = to_csr(B, p);
+  return C;
+}
+}
@@ -0,0 +1,424 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+#include "mmio/sample.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mmio
+{
+/// A lock-free open-addressing hash map from (row, col) to a combined value.
+///
+/// Any number of threads may `insert` concurrently. A new key claims an empty
+/// slot with a compare-and-swap to a busy marker, stores its value, and then
+/// publishes the key, so threads probing that slot wait only for the one
+/// store. A repeated key folds its value in with `combine`, in a
+/// compare-and-swap loop on the slot's value, so the combiner should be
+/// associative and commutative.
+///
+/// The map grows in levels rather than by rehashing. A key is only ever
+/// placed within `max_probes_` slots of its hash, and an insert that finds no
+/// room in the newest level adds a level four times larger. Older levels stay
+/// in place and keep combining the keys they hold, while new keys go to the
+/// newest level. A key that races into two levels while one is being added
+/// is folded back into its oldest level by `entries`. The initial capacity is
+/// rounded up to a power of two, and about twice the number of distinct keys
+/// keeps everything in the first level.
+template <class V>
+class concurrent_edge_map
+{
+  static_assert(std::is_trivially_copyable_v<V>, "concurrent_edge_map values must be trivially copyable");
+
+  static constexpr std::uint64_t empty_ = ~std::uint64_t(0);
+  static constexpr std::uint64_t busy_ = ~std::uint64_t(1);
+  static constexpr std::uint64_t moved_ = ~std::uint64_t(2);
+  static constexpr std::size_t max_probes_ = 64;
+  static constexpr int max_levels_ = 24;
+
+  struct alignas(std::atomic_ref<V>::required_alignment) value
+  {
+    V v;
+  };
+
+  struct level
+  {
+    std::unique_ptr<std::atomic<std::uint64_t>[]> keys;
+    std::unique_ptr<value[]> values;
+    std::size_t mask = 0;
+    int shift = 64;
+
+    level(std::size_t capacity, int p)
+    {
+      std::size_t n = std::bit_ceil(std::max<std::size_t>(capacity, 2));
+      keys.reset(new std::atomic<std::uint64_t>[n]);
+      values.reset(new value[n]);
+      mask = n - 1;
+      shift = 64 - std::countr_zero(n);
+      parallel_for(n, p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+        for (; i < e; ++i) {
+          keys[i].store(empty_, std::memory_order_relaxed);
+        }
+      });
+    }
+
+    std::size_t capacity() const {
+      return mask + 1;
+    }
+
+    std::size_t probes() const {
+      return std::min(max_probes_, capacity());
+    }
+
+    std::size_t slot(std::uint64_t k) const {
+      return ((k ^ (k >> 29)) * 0x9e3779b97f4a7c15ull) >> shift;
+    }
+
+    std::uint64_t wait(std::size_t i) const {
+      std::uint64_t k;
+      while ((k = keys[i].load(std::memory_order_acquire)) == busy_) {
+      }
+      return k;
+    }
+
+    /// The slot holding `k`, or -1.
+    std::ptrdiff_t find(std::uint64_t k) const {
+      for (std::size_t i = slot(k), n = 0; n < probes(); i = (i + 1) & mask, ++n) {
+        std::uint64_t found = keys[i].load(std::memory_order_relaxed);
+        if (found == k) {
+          return i;
+        }
+        if (found == empty_) {
+          return -1;
+        }
+      }
+      return -1;
+    }
+  };
+
+  std::unique_ptr<level> levels_[max_levels_];
+  std::atomic<int> n_levels_ = 0;
+  std::mutex grow_;
+  int p_;
+
+  static std::uint64_t key(std::int32_t u, std::int32_t v) {
+    return (std::uint64_t(std::uint32_t(u)) << 32) | std::uint32_t(v);
+  }
+
+  /// Add level `l` unless another thread already has.
+  void grow(int l)
+  {
+    std::lock_guard lock(grow_);
+    if (n_levels_.load(std::memory_order_relaxed) == l) {
+      if (l == max_levels_) {
+        fprintf(stderr, "concurrent_edge_map failed: capacity %zu exceeded\n", capacity());
+        std::exit(EXIT_FAILURE);
+      }
+      levels_[l] = std::make_unique<level>(4 * levels_[l - 1]->capacity(), p_);
+      n_levels_.store(l + 1, std::memory_order_release);
+    }
+  }
+
+ public:
+  explicit concurrent_edge_map(std::size_t capacity, int p = default_threads())
+      : p_(p)
+  {
+    levels_[0] = std::make_unique<level>(capacity, p);
+    n_levels_.store(1, std::memory_order_release);
+  }
+
+  /// The total number of slots over all levels.
+  std::size_t capacity() const {
+    std::size_t n = 0;
+    for (int l = 0, e = n_levels_.load(std::memory_order_acquire); l < e; ++l) {
+      n += levels_[l]->capacity();
+    }
+    return n;
+  }
+
+  int levels() const {
+    return n_levels_.load(std::memory_order_acquire);
+  }
+
+  /// Insert (`u`, `v`) with value `w`, or combine `w` into its value if it
+  /// is already present. Returns true if this call added the key.
+  template <class C>
+  bool insert(std::int32_t u, std::int32_t v, const V& w, const C& combine)
+  {
+    std::uint64_t k = key(u, v);
+    for (int l = 0; ; ++l) {
+      if (l == n_levels_.load(std::memory_order_acquire)) {
+        grow(l);
+      }
+      level& L = *levels_[l];
+      bool newest = (l + 1 == n_levels_.load(std::memory_order_acquire));
+      for (std::size_t i = L.slot(k), n = 0; n < L.probes(); i = (i + 1) & L.mask, ++n) {
+        std::uint64_t found = L.wait(i);
+        if (found == empty_) {
+          // An older level has no room for new keys, so the key is not here.
+          if (!newest) {
+            break;
+          }
+          if (L.keys[i].compare_exchange_strong(found, busy_, std::memory_order_acquire)) {
+            L.values[i].v = w;
+            L.keys[i].store(k, std::memory_order_release);
+            return true;
+          }
+          found = L.wait(i);
+        }
+        if (found == k) {
+          std::atomic_ref<V> ref(L.values[i].v);
+          V old = ref.load(std::memory_order_relaxed);
+          while (!ref.compare_exchange_weak(old, V(combine(old, w)), std::memory_order_relaxed)) {
+          }
+          return false;
+        }
+      }
+    }
+  }
+
+  /// Gather the entries into an `n_rows x n_cols` COO matrix, in slot order.
+  ///
+  /// This first folds keys that reached more than one level into their
+  /// oldest level with `combine`, so it must not run concurrently with
+  /// `insert`.
+  template <class I = std::int32_t, class C = std::plus<>>
+  coo<I, V> entries(std::int32_t n_rows, std::int32_t n_cols, const C& combine = {}, int p = default_threads())
+  {
+    int n_levels = levels();
+    for (int l = 1; l < n_levels; ++l) {
+      level& L = *levels_[l];
+      parallel_for(L.capacity(), p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+        for (; i < e; ++i) {
+          std::uint64_t k = L.keys[i].load(std::memory_order_relaxed);
+          if (k == empty_ || k == moved_) {
+            continue;
+          }
+          for (int j = 0; j < l; ++j) {
+            if (std::ptrdiff_t x = levels_[j]->find(k); x >= 0) {
+              V& old = levels_[j]->values[x].v;
+              old = V(combine(old, L.values[i].v));
+              L.keys[i].store(moved_, std::memory_order_relaxed);
+              break;
+            }
+          }
+        }
+      });
+    }
+
+    std::vector<std::ptrdiff_t> counts(n_levels * p + 1);
+    for (int l = 0; l < n_levels; ++l) {
+      const level& L = *levels_[l];
+      parallel_for(L.capacity(), p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t e) {
+        std::ptrdiff_t n = 0;
+        for (; i < e; ++i) {
+          std::uint64_t k = L.keys[i].load(std::memory_order_relaxed);
+          n += (k != empty_ && k != moved_);
+        }
+        counts[l * p + t + 1] = n;
+      });
+    }
+    prefix_sum(counts.begin(), counts.end(), 1);
+
+    coo<I, V> A;
+    A.n_rows = n_rows;
+    A.n_cols = n_cols;
+    A.rows.resize(counts.back());
+    A.cols.resize(counts.back());
+    A.values.resize(counts.back());
+    for (int l = 0; l < n_levels; ++l) {
+      const level& L = *levels_[l];
+      parallel_for(L.capacity(), p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t e) {
+        for (std::ptrdiff_t j = counts[l * p + t]; i < e; ++i) {
+          if (std::uint64_t k = L.keys[i].load(std::memory_order_relaxed); k != empty_ && k != moved_) {
+            A.rows[j] = std::int32_t(k >> 32);
+            A.cols[j] = std::int32_t(k);
+            A.values[j] = L.values[i].v;
+            ++j;
+          }
+        }
+      });
+    }
+    return A;
+  }
+};
+
+/// Estimate how many distinct entries `mm` stores from a sample of `k` of
+/// them, with Shlosser's estimator. With sampling fraction q and f_i entries
+/// seen i times in the sample, the sample's distinct count is scaled up by
+/// f_1 times sum (1-q)^i f_i over sum i q (1-q)^(i-1) f_i, which is about
+/// 1/q when nearly everything is distinct and near 1 when little is. With
+/// `upper`, (u, v) and (v, u) count as one.
+inline static std::ptrdiff_t
+estimate_distinct_edges(const MatrixMarketFile& mm, bool upper = false,
+                        std::ptrdiff_t k = std::ptrdiff_t(1) << 15,
+                        std::uint64_t seed = 1)
+{
+  std::vector<std::uint64_t> keys;
+  for (auto&& [u, v] : sample_edges<>(mm, k, seed)) {
+    if (upper && v < u) {
+      std::swap(u, v);
+    }
+    keys.push_back((std::uint64_t(std::uint32_t(u)) << 32) | std::uint32_t(v));
+  }
+  if (keys.empty()) {
+    return 0;
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // f[i] is the number of keys seen i times.
+  std::vector<double> f(2);
+  for (std::size_t i = 0, j; i < keys.size(); i = j) {
+    for (j = i + 1; j < keys.size() && keys[j] == keys[i]; ++j) {
+    }
+    f.resize(std::max(f.size(), j - i + 1));
+    f[j - i] += 1;
+  }
+
+  double n = mm.getNEdges();
+  double q = keys.size() / n;
+  double d = 0, num = 0, den = 0;
+  for (std::size_t i = 1; i < f.size(); ++i) {
+    d += f[i];
+    num += std::pow(1 - q, i) * f[i];
+    den += i * q * std::pow(1 - q, i - 1) * f[i];
+  }
+  return std::ptrdiff_t(std::min(n, std::ceil(d + f[1] * num / den)));
+}
+
+/// Load the distinct entries of `mm` into a COO matrix, combining the values
+/// of duplicates with `combine`, without sorting.
+///
+/// The parser threads insert each entry straight into a
+/// `concurrent_edge_map`, and the distinct entries are gathered afterward in
+/// no particular order. The map starts at twice the distinct count that
+/// `estimate_distinct_edges` predicts, so memory follows the distinct
+/// entries rather than the file size, and grows if the estimate is low.
+/// Symmetric files are stored according to `s`, with mirrored entries
+/// combined like any other. For pattern files every entry has value `V(1)`,
+/// so the default `std::plus` counts multiplicities.
+template <class I = std::int32_t, class V = double, class C = std::plus<>>
+inline static coo<I, V>
+dedup_edges(const MatrixMarketFile& mm, const C& combine = {},
+            symmetric_storage s = symmetric_storage::full,
+            int p = default_threads())
+{
+  edge_partition parts = partition_edges(mm, p);
+  bool mirror = !mm.isGeneral() && s == symmetric_storage::full;
+  bool upper = !mm.isGeneral() && s == symmetric_storage::upper;
+  bool skew = mm.isSkew();
+  std::ptrdiff_t distinct = estimate_distinct_edges(mm, upper);
+  concurrent_edge_map<V> map(std::max<std::ptrdiff_t>(2 * distinct * (mirror ? 2 : 1), 1 << 10), p);
+
+  auto add = [&](std::int32_t u, std::int32_t v, V w) {
+    if (upper && v < u) {
+      std::swap(u, v);
+      w = (skew) ? negate(w) : w;
+    }
+    map.insert(u, v, w, combine);
+    if (mirror && u != v) {
+      map.insert(v, u, (skew) ? negate(w) : w, combine);
+    }
+  };
+
+  bool pattern = mm.isPattern();
+  parallel(p, [&](int t) {
+    if (pattern) {
+      for (auto&& [u, v] : parts.range(t)) {
+        add(u, v, V(1));
+      }
+    }
+    else {
+      for (auto&& [u, v, w] : parts.range<V>(t)) {
+        add(u, v, w);
+      }
+    }
+  });
+  return map.template entries<I>(mm.getNRows(), mm.getNCols(), combine, p);
+}
+
+/// Merge duplicate entries of a CSR matrix in parallel, combining their
+/// values with `combine` in column order.
+///
+/// This is the sort-based counterpart of `dedup_edges`, relying on the
+/// sorted rows produced by the builders.
+template <class I, class V, class C = std::plus<>>
+inline static void
+combine_duplicates(csr<I, V>& A, const C& combine = {}, int p = default_threads())
+{
+  std::vector<I> offsets(A.n_rows + 1);
+  parallel(p, [&](int t) {
+    for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+      I n = 0;
+      for (I k = A.offsets[i]; k < A.offsets[i + 1]; ++k) {
+        n += (k == A.offsets[i] || A.indices[k] != A.indices[k - 1]);
+      }
+      offsets[i + 1] = n;
+    }
+  });
+  prefix_sum(offsets.begin(), offsets.end(), p);
+
+  std::vector<I> indices(offsets.back());
+  std::vector<V> values(offsets.back());
+  parallel(p, [&](int t) {
+    for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+      I j = offsets[i] - 1;
+      for (I k = A.offsets[i]; k < A.offsets[i + 1]; ++k) {
+        if (k == A.offsets[i] || A.indices[k] != A.indices[k - 1]) {
+          indices[++j] = A.indices[k];
+          values[j] = A.values[k];
+        }
+        else {
+          values[j] = V(combine(values[j], A.values[k]));
+        }
+      }
+    }
+  });
+
+  A.offsets = std::move(offsets);
+  A.indices = std::move(indices);
+  A.values = std::move(values);
+}
+}
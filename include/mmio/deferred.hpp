@@ -0,0 +1,171 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace mmio
+{
+/// The structure of a coordinate file with its values left undecoded.
+///
+/// Entries are 0-based and exactly as stored in the file, including only one
+/// triangle of symmetric files. Each entry records where its value field
+/// starts as a 32-bit offset from the start of its chunk, which is at most
+/// 2 GiB long, so the values can be decoded later for any subset of entries.
+/// Pattern files record no offsets.
+template <class I = std::int32_t>
+struct deferred_coo
+{
+  using index_type = I;
+
+  std::int32_t n_rows = 0;
+  std::int32_t n_cols = 0;
+  std::vector<I>  rows;
+  std::vector<I>  cols;
+  std::vector<std::uint32_t> value_offsets;
+  std::vector<std::ptrdiff_t> chunk_first;      // first entry of each chunk, then nnz
+  std::vector<std::ptrdiff_t> chunk_base;       // byte offset of each chunk
+
+  std::ptrdiff_t nnz() const {
+    return rows.size();
+  }
+
+  /// The byte offset in the file of the value field of entry `k`.
+  std::ptrdiff_t value_offset(std::ptrdiff_t k) const {
+    auto c = std::upper_bound(chunk_first.begin(), chunk_first.end() - 1, k) - chunk_first.begin() - 1;
+    return chunk_base[c] + value_offsets[k];
+  }
+};
+
+/// Parse only the (row, col) structure of `mm`, in parallel, recording the
+/// offset of each value field instead of converting it.
+template <class I = std::int32_t>
+inline static deferred_coo<I>
+parse_structure(const MatrixMarketFile& mm, int p = default_threads())
+{
+  // Keep chunks short enough for 32-bit offsets.
+  std::ptrdiff_t bytes = mm.getBytes().size();
+  std::ptrdiff_t n = std::max<std::ptrdiff_t>(p, bytes / (std::ptrdiff_t(1) << 31) + 1);
+  edge_partition parts = partition_edges(mm, n, p);
+
+  deferred_coo<I> A;
+  A.n_rows = mm.getNRows();
+  A.n_cols = mm.getNCols();
+  A.rows.resize(parts.edges());
+  A.cols.resize(parts.edges());
+  A.chunk_first = parts.offsets;
+  A.chunk_base.resize(n);
+  for (std::ptrdiff_t t = 0; t < n; ++t) {
+    A.chunk_base[t] = parts.bounds[t] - mm.getBytes().data();
+  }
+
+  bool pattern = mm.isPattern();
+  if (!pattern) {
+    A.value_offsets.resize(parts.edges());
+  }
+
+  parallel_for(n, p, [&](int, std::ptrdiff_t t, std::ptrdiff_t e) {
+    for (; t < e; ++t) {
+      const char* base = parts.bounds[t];
+      const char* end = parts.bounds[t + 1];
+      std::ptrdiff_t k = parts.offsets[t];
+      for (const char* i = base; i < end; ++k) {
+        char* j;
+        A.rows[k] = std::strtol(i, &j, 10) - 1;
+        A.cols[k] = std::strtol(j, &j, 10) - 1;
+        if (!pattern) {
+          A.value_offsets[k] = j - base;
+        }
+        auto next = static_cast<const char*>(std::memchr(j, '\n', end - j));
+        i = (next) ? next + 1 : end;
+      }
+    }
+  });
+  return A;
+}
+
+/// Decode the values of the entries of `A` listed in `selection`, in
+/// parallel, returning them in selection order.
+///
+/// `mm` must be the file that `A` was parsed from. Values are parsed as `V`
+/// exactly as the builders do, and pattern files produce `V(1)`.
+template <class V = double, class I>
+inline static std::vector<V>
+materialize_values(const MatrixMarketFile& mm, const deferred_coo<I>& A,
+                   std::span<const std::ptrdiff_t> selection,
+                   int p = default_threads())
+{
+  std::vector<V> values(selection.size(), V(1));
+  if (A.value_offsets.empty()) {
+    return values;
+  }
+
+  const char* base = mm.getBytes().data();
+  parallel_for(selection.size(), p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (; i < e; ++i) {
+      const char* j = base + A.value_offset(selection[i]);
+      values[i] = MatrixMarketFile::edge_iterator<V>::template get<V>(j);
+    }
+  });
+  return values;
+}
+
+/// Gather the entries of `A` listed in `selection` into a COO matrix,
+/// decoding only their values.
+template <class V = double, class I>
+inline static coo<I, V>
+materialize(const MatrixMarketFile& mm, const deferred_coo<I>& A,
+            std::span<const std::ptrdiff_t> selection,
+            int p = default_threads())
+{
+  coo<I, V> B;
+  B.n_rows = A.n_rows;
+  B.n_cols = A.n_cols;
+  B.rows.resize(selection.size());
+  B.cols.resize(selection.size());
+  parallel_for(selection.size(), p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (; i < e; ++i) {
+      B.rows[i] = A.rows[selection[i]];
+      B.cols[i] = A.cols[selection[i]];
+    }
+  });
+  B.values = materialize_values<V>(mm, A, selection, p);
+  return B;
+}
+}
@@ -0,0 +1,161 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/parallel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace mmio
+{
+/// The number of bytes in each leaf of the content hash tree.
+///
+/// The leaf size is fixed so that a content hash never depends on the number
+/// of threads used to compute it.
+inline constexpr std::ptrdiff_t hash_leaf_bytes = std::ptrdiff_t(64) << 10;
+
+/// A 64-bit hash of `[data, data + n)` using the XXH64 algorithm.
+std::uint64_t hash_bytes(const char* data, std::size_t n, std::uint64_t seed = 0);
+
+/// Hash leaf `j` of the `n`-byte buffer `data`.
+inline static std::uint64_t
+hash_leaf(const char* data, std::ptrdiff_t n, std::ptrdiff_t j)
+{
+  std::ptrdiff_t i = j * hash_leaf_bytes;
+  return hash_bytes(data + i, std::min(hash_leaf_bytes, n - i), j);
+}
+
+/// The number of leaves in the hash tree of an `n`-byte buffer.
+inline static std::ptrdiff_t
+hash_leaves(std::ptrdiff_t n)
+{
+  return (n + hash_leaf_bytes - 1) / hash_leaf_bytes;
+}
+
+/// Combine the leaf hashes of an `n`-byte buffer into its root hash.
+inline static std::uint64_t
+hash_root(const std::vector<std::uint64_t>& leaves, std::ptrdiff_t n)
+{
+  return hash_bytes(reinterpret_cast<const char*>(leaves.data()),
+                    leaves.size() * sizeof(std::uint64_t), n);
+}
+
+/// A content hash of all of the bytes in `mm`, computed in parallel.
+///
+/// Fixed-size leaves are hashed independently and their hashes are hashed
+/// again to form the root, so the result only depends on the file's bytes.
+/// Builders can compute the same hash during their parse; see `digest`.
+inline static std::uint64_t
+content_hash(const MatrixMarketFile& mm, int p = default_threads())
+{
+  std::string_view bytes = mm.getBytes();
+  std::vector<std::uint64_t> leaves(hash_leaves(bytes.size()));
+  parallel_for(leaves.size(), p, [&](int, std::ptrdiff_t j, std::ptrdiff_t e) {
+    for (; j < e; ++j) {
+      leaves[j] = hash_leaf(bytes.data(), bytes.size(), j);
+    }
+  });
+  return hash_root(leaves, bytes.size());
+}
+
+/// The splitmix64 finalizer, a fast 64-bit mixing function.
+inline static constexpr std::uint64_t
+mix64(std::uint64_t x)
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+/// An order-independent fingerprint of the entries of a matrix.
+///
+/// Each (row, col, value) triple is mixed into a 64-bit key and the keys are
+/// summed twice with different mixes, so the fingerprint is independent of
+/// entry order, number formatting, and thread count. Values contribute the
+/// bits of their `double` conversion, with -0.0 treated as 0.0. Triples of
+/// symmetric files are normalized to the lower triangle first, negating
+/// skew-symmetric values, so either triangle yields the same fingerprint.
+struct matrix_fingerprint
+{
+  std::int64_t  n_rows = 0;
+  std::int64_t  n_cols = 0;
+  std::int64_t     nnz = 0;
+  char        symmetry = 'G';                   // MM_typecode[3]
+  std::uint64_t     lo = 0;
+  std::uint64_t     hi = 0;
+
+  bool operator==(const matrix_fingerprint&) const = default;
+
+  /// Add one stored entry.
+  void add(std::int64_t r, std::int64_t c, double v) {
+    if (symmetry != 'G' && r < c) {
+      std::swap(r, c);
+      v = (symmetry == 'K') ? -v : v;
+    }
+    std::uint64_t bits = (v == 0.0) ? 0 : std::bit_cast<std::uint64_t>(v);
+    std::uint64_t key = mix64((std::uint64_t(r) << 32 | std::uint32_t(c)) ^ mix64(bits));
+    lo += key;
+    hi += mix64(key ^ 0x9e3779b97f4a7c15ull);
+    ++nnz;
+  }
+
+  /// Merge the entries of another partial fingerprint.
+  void merge(const matrix_fingerprint& b) {
+    lo += b.lo;
+    hi += b.hi;
+    nnz += b.nnz;
+  }
+
+  /// A single 64-bit key for the whole fingerprint.
+  std::uint64_t key() const {
+    std::uint64_t words[] = {
+      std::uint64_t(n_rows), std::uint64_t(n_cols), std::uint64_t(nnz),
+      std::uint64_t(symmetry), lo, hi
+    };
+    return hash_bytes(reinterpret_cast<const char*>(words), sizeof(words));
+  }
+};
+
+/// Digests that the builders can compute during their parse.
+struct digest
+{
+  std::uint64_t content = 0;                    // see `content_hash`
+  matrix_fingerprint fingerprint;
+};
+}
@@ -0,0 +1,160 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace mmio
+{
+/// A lock-free open-addressing hash map from 32-bit vertex IDs to dense IDs.
+///
+/// The map is filled in two phases. During the parse any number of threads
+/// `insert` the IDs they see, each claiming an empty slot with a single
+/// compare-and-swap on its key and probing linearly on collisions. Once the
+/// inserts are done, `assign` records the dense ID of each key, again from
+/// any number of threads since distinct keys own distinct slots, and `find`
+/// reads them back. The capacity is fixed, rounded up to a power of two, and
+/// should be about twice the number of distinct keys.
+class concurrent_id_map
+{
+  static constexpr std::int32_t empty_ = std::numeric_limits<std::int32_t>::min();
+
+  std::unique_ptr<std::atomic<std::int32_t>[]> keys_;
+  std::unique_ptr<std::int32_t[]> values_;
+  std::size_t mask_ = 0;
+  int shift_ = 64;
+
+  std::size_t slot(std::int32_t key) const {
+    return (std::uint64_t(std::uint32_t(key)) * 0x9e3779b97f4a7c15ull) >> shift_;
+  }
+
+ public:
+  concurrent_id_map() = default;
+
+  explicit concurrent_id_map(std::size_t capacity, int p = default_threads())
+  {
+    std::size_t n = std::bit_ceil(std::max<std::size_t>(capacity, 2));
+    keys_.reset(new std::atomic<std::int32_t>[n]);
+    values_.reset(new std::int32_t[n]);
+    mask_ = n - 1;
+    shift_ = 64 - std::countr_zero(n);
+    parallel_for(n, p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+      for (; i < e; ++i) {
+        keys_[i].store(empty_, std::memory_order_relaxed);
+      }
+    });
+  }
+
+  std::size_t capacity() const {
+    return mask_ + 1;
+  }
+
+  /// Insert `key`, returning true if this call added it.
+  bool insert(std::int32_t key)
+  {
+    for (std::size_t i = slot(key), n = 0; n <= mask_; i = (i + 1) & mask_, ++n) {
+      std::int32_t k = keys_[i].load(std::memory_order_relaxed);
+      if (k == key) {
+        return false;
+      }
+      if (k == empty_) {
+        if (keys_[i].compare_exchange_strong(k, key, std::memory_order_relaxed)) {
+          return true;
+        }
+        if (k == key) {
+          return false;
+        }
+      }
+    }
+    fprintf(stderr, "concurrent_id_map failed: capacity %zu exceeded\n", capacity());
+    std::exit(EXIT_FAILURE);
+  }
+
+  /// Set the dense ID of an inserted `key`.
+  void assign(std::int32_t key, std::int32_t value)
+  {
+    for (std::size_t i = slot(key); ; i = (i + 1) & mask_) {
+      if (keys_[i].load(std::memory_order_relaxed) == key) {
+        values_[i] = value;
+        return;
+      }
+    }
+  }
+
+  /// The dense ID of `key`, or -1 if it was never inserted.
+  std::int32_t find(std::int32_t key) const
+  {
+    for (std::size_t i = slot(key), n = 0; n <= mask_; i = (i + 1) & mask_, ++n) {
+      std::int32_t k = keys_[i].load(std::memory_order_relaxed);
+      if (k == key) {
+        return values_[i];
+      }
+      if (k == empty_) {
+        break;
+      }
+    }
+    return -1;
+  }
+
+  /// The inserted keys, in slot order, gathered in parallel.
+  std::vector<std::int32_t> keys(int p = default_threads()) const
+  {
+    std::vector<std::ptrdiff_t> counts(p + 1);
+    parallel_for(capacity(), p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t e) {
+      std::ptrdiff_t n = 0;
+      for (; i < e; ++i) {
+        n += keys_[i].load(std::memory_order_relaxed) != empty_;
+      }
+      counts[t + 1] = n;
+    });
+    prefix_sum(counts.begin(), counts.end(), 1);
+
+    std::vector<std::int32_t> keys(counts[p]);
+    parallel_for(capacity(), p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t e) {
+      for (std::ptrdiff_t k = counts[t]; i < e; ++i) {
+        if (std::int32_t key = keys_[i].load(std::memory_order_relaxed); key != empty_) {
+          keys[k++] = key;
+        }
+      }
+    });
+    return keys;
+  }
+};
+}
@@ -0,0 +1,259 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace mmio
+{
+/// Accumulate per-thread contributions to an `n` vector `y`, in parallel.
+///
+/// `f(t, out)` adds thread `t`'s contributions into `out`. Thread 0 writes
+/// `y` directly, the others write private zeroed buffers that are then summed
+/// into `y` by row blocks. This trades `(p - 1) * n` scratch for freedom from
+/// atomics in scatter-style kernels.
+template <class V, class F>
+inline static void
+scatter_reduce(std::span<V> y, int p, F&& f)
+{
+  std::ptrdiff_t n = y.size();
+  std::vector<V> partial((p - 1) * n);
+  parallel(p, [&](int t) {
+    V* out = (t == 0) ? y.data() : partial.data() + (t - 1) * n;
+    std::fill(out, out + n, V());
+    f(t, out);
+  });
+
+  if (p == 1) {
+    return;
+  }
+
+  parallel_for(n, p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    for (; i < e; ++i) {
+      for (int t = 1; t < p; ++t) {
+        y[i] += partial[(t - 1) * n + i];
+      }
+    }
+  });
+}
+
+/// Sparse matrix-vector product `y = A x` for a CSR matrix.
+///
+/// Rows are split into blocks with balanced nnz, so each `y[i]` is written
+/// by exactly one thread.
+template <class I, class V>
+inline static void
+spmv(const csr<I, V>& A,
+     std::type_identity_t<std::span<const V>> x,
+     std::type_identity_t<std::span<V>> y,
+     int p = default_threads())
+{
+  assert(std::ssize(x) >= A.n_cols);
+  assert(std::ssize(y) >= A.n_rows);
+  parallel(p, [&](int t) {
+    for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+      V sum = V();
+      for (I k = A.offsets[i]; k < A.offsets[i + 1]; ++k) {
+        sum += A.values[k] * x[A.indices[k]];
+      }
+      y[i] = sum;
+    }
+  });
+}
+
+/// Sparse matrix-vector product `y = A x` for a COO matrix.
+///
+/// COO entries carry no row order, so entries are split evenly and reduced
+/// through `scatter_reduce`.
+template <class I, class V>
+inline static void
+spmv(const coo<I, V>& A,
+     std::type_identity_t<std::span<const V>> x,
+     std::type_identity_t<std::span<V>> y,
+     int p = default_threads())
+{
+  assert(std::ssize(x) >= A.n_cols);
+  assert(std::ssize(y) >= A.n_rows);
+  scatter_reduce(y.first(A.n_rows), p, [&](int t, V* out) {
+    for (std::ptrdiff_t k = block_begin(A.nnz(), p, t), e = block_begin(A.nnz(), p, t + 1); k < e; ++k) {
+      out[A.rows[k]] += A.values[k] * x[A.cols[k]];
+    }
+  });
+}
+
+/// Transposed sparse matrix-vector product `y = A^T x` for a CSR matrix.
+template <class I, class V>
+inline static void
+spmv_transpose(const csr<I, V>& A,
+               std::type_identity_t<std::span<const V>> x,
+               std::type_identity_t<std::span<V>> y,
+               int p = default_threads())
+{
+  assert(std::ssize(x) >= A.n_rows);
+  assert(std::ssize(y) >= A.n_cols);
+  scatter_reduce(y.first(A.n_cols), p, [&](int t, V* out) {
+    for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+      V xi = x[i];
+      for (I k = A.offsets[i]; k < A.offsets[i + 1]; ++k) {
+        out[A.indices[k]] += A.values[k] * xi;
+      }
+    }
+  });
+}
+
+/// Sparse matrix-vector product `y = A x` for a `blocked_csr` matrix.
+///
+/// Threads take ranges of whole index blocks with balanced nnz. Each block
+/// offsets `x` by its column base, and then reads its 16- or 32-bit indices.
+template <class I, class V>
+inline static void
+spmv(const blocked_csr<I, V>& A,
+     std::type_identity_t<std::span<const V>> x,
+     std::type_identity_t<std::span<V>> y,
+     int p = default_threads())
+{
+  assert(std::ssize(x) >= A.n_cols);
+  assert(std::ssize(y) >= A.n_rows);
+
+  // `indices` starts at the block's first entry, which is entry `first`.
+  auto rows = [&](const auto* indices, const V* xb, std::int32_t r, std::int32_t s) {
+    I first = A.offsets[r];
+    for (; r < s; ++r) {
+      V sum = V();
+      for (I k = A.offsets[r]; k < A.offsets[r + 1]; ++k) {
+        sum += A.values[k] * xb[indices[k - first]];
+      }
+      y[r] = sum;
+    }
+  };
+
+  parallel(p, [&](int t) {
+    for (std::ptrdiff_t b = A.block_begin(p, t), e = A.block_begin(p, t + 1); b < e; ++b) {
+      auto& blk = A.blocks[b];
+      std::int32_t r = b * A.block_rows;
+      std::int32_t s = std::min<std::int64_t>(r + A.block_rows, A.n_rows);
+      if (blk.wide) {
+        rows(A.wide.data() + blk.start, x.data() + blk.base, r, s);
+      }
+      else {
+        rows(A.narrow.data() + blk.start, x.data() + blk.base, r, s);
+      }
+    }
+  });
+}
+
+/// Shared implementation of the triangle-storage kernels, where mirrored
+/// contributions are scaled by `sign`.
+template <class I, class V>
+inline static void
+spmv_triangle(const csr<I, V>& A, std::span<const V> x, std::span<V> y, V sign, int p)
+{
+  assert(A.n_rows == A.n_cols);
+  assert(std::ssize(x) >= A.n_cols);
+  assert(std::ssize(y) >= A.n_rows);
+  scatter_reduce(y.first(A.n_rows), p, [&](int t, V* out) {
+    for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+      V xi = x[i];
+      V sum = V();
+      for (I k = A.offsets[i]; k < A.offsets[i + 1]; ++k) {
+        I j = A.indices[k];
+        V a = A.values[k];
+        sum += a * x[j];
+        if (j != i) {
+          out[j] += sign * a * xi;
+        }
+      }
+      out[i] += sum;
+    }
+  });
+}
+
+/// Symmetric sparse matrix-vector product `y = A x`, where `A` holds a single
+/// triangle of a symmetric matrix (see `symmetric_storage::upper`).
+///
+/// Each stored entry is read once and applied to both `y[i]` and `y[j]`.
+template <class I, class V>
+inline static void
+spmv_symmetric(const csr<I, V>& A,
+               std::type_identity_t<std::span<const V>> x,
+               std::type_identity_t<std::span<V>> y,
+               int p = default_threads())
+{
+  spmv_triangle(A, x, y, V(1), p);
+}
+
+/// Skew-symmetric sparse matrix-vector product `y = A x`, where `A` holds the
+/// upper triangle of a skew-symmetric matrix.
+template <class I, class V>
+inline static void
+spmv_skew_symmetric(const csr<I, V>& A,
+                    std::type_identity_t<std::span<const V>> x,
+                    std::type_identity_t<std::span<V>> y,
+                    int p = default_threads())
+{
+  spmv_triangle(A, x, y, V(-1), p);
+}
+
+/// Sparse matrix-dense matrix product `Y = A X` for a CSR matrix.
+///
+/// `X` is an `n_cols x k` and `Y` an `n_rows x k` block of vectors, both
+/// row-major, so each nonzero streams one contiguous row of `X`.
+template <class I, class V>
+inline static void
+spmm(const csr<I, V>& A,
+     std::type_identity_t<std::span<const V>> X,
+     std::type_identity_t<std::span<V>> Y,
+     std::ptrdiff_t k,
+     int p = default_threads())
+{
+  assert(std::ssize(X) >= A.n_cols * k);
+  assert(std::ssize(Y) >= A.n_rows * k);
+  parallel(p, [&](int t) {
+    for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+      V* y = &Y[i * k];
+      std::fill(y, y + k, V());
+      for (I n = A.offsets[i]; n < A.offsets[i + 1]; ++n) {
+        V a = A.values[n];
+        const V* x = &X[A.indices[n] * k];
+        for (std::ptrdiff_t j = 0; j < k; ++j) {
+          y[j] += a * x[j];
+        }
+      }
+    }
+  });
+}
+}
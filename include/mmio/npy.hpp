@@ -0,0 +1,162 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+#include "mmio/writers.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace mmio
+{
+/// The NumPy dtype descriptor of a primitive type, e.g., "<i4" or "<f8".
+template <class T>
+inline static std::string
+npy_descr()
+{
+  constexpr char order = (sizeof(T) == 1) ? '|' : (std::endian::native == std::endian::little) ? '<' : '>';
+  if constexpr (std::is_floating_point_v<T>) {
+    return { order, 'f', char('0' + sizeof(T)) };
+  }
+  else if constexpr (std::is_integral_v<T>) {
+    return { order, (std::is_signed_v<T>) ? 'i' : 'u', char('0' + sizeof(T)) };
+  }
+  else {
+    static_assert(!sizeof(T), "type has no NumPy equivalent");
+  }
+}
+
+/// Format a version 1.0 .npy header for a C-order array of `descr` with
+/// `shape`, padded so that the array data starts at a multiple of 64 bytes
+/// when the header is written at byte `offset`.
+std::string npy_header(std::string_view descr,
+                       const std::vector<std::int64_t>& shape,
+                       std::ptrdiff_t offset = 0);
+
+/// The CRC-32 of `[data, data + n)`, continuing from `crc`.
+std::uint32_t crc32(const char* data, std::size_t n, std::uint32_t crc = 0);
+
+/// The CRC-32 of the concatenation of two blocks, given the CRC-32 of each
+/// and the length `n` of the second one.
+std::uint32_t crc32_combine(std::uint32_t a, std::uint32_t b, std::size_t n);
+
+/// Write a one-dimensional .npy file, in parallel.
+template <class T>
+inline static void
+write_npy(const std::filesystem::path& path, const std::vector<T>& a, int p = default_threads())
+{
+  std::string header = npy_header(npy_descr<T>(), { std::int64_t(a.size()) });
+  int fd = open_output(path);
+  pwrite_all(fd, header.data(), header.size(), 0);
+  parallel_for(a.size(), p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+    pwrite_all(fd, reinterpret_cast<const char*>(a.data() + i), (e - i) * sizeof(T), header.size() + i * sizeof(T));
+  });
+  close_output(fd);
+}
+
+/// A writer of uncompressed .npz archives, i.e., zip files of .npy members.
+///
+/// Each member is written in place with one parallel pass that `pwrite`s
+/// and checksums blocks of the array, and its .npy header is padded so that
+/// the array starts 64-byte aligned in the archive. Zip64 records are used
+/// for members and archives past 4 GiB.
+class npz_writer
+{
+  struct member
+  {
+    std::string     name;
+    std::uint32_t    crc = 0;
+    std::int64_t    size = 0;
+    std::int64_t  offset = 0;
+  };
+
+  int fd_ = -1;
+  std::int64_t offset_ = 0;
+  std::vector<member> members_;
+
+ public:
+  explicit npz_writer(const std::filesystem::path& path);
+  npz_writer(const npz_writer&) = delete;
+  ~npz_writer();
+
+  /// Add `name`.npy holding `bytes` bytes of `data` with `descr` and `shape`.
+  void add(std::string_view name, std::string_view descr,
+           const std::vector<std::int64_t>& shape,
+           const char* data, std::size_t bytes,
+           int p = default_threads());
+
+  /// Add a one-dimensional array as `name`.npy.
+  template <class T>
+  void add(std::string_view name, const std::vector<T>& a, int p = default_threads()) {
+    add(name, npy_descr<T>(), { std::int64_t(a.size()) },
+        reinterpret_cast<const char*>(a.data()), a.size() * sizeof(T), p);
+  }
+
+  /// Write the central directory and close the archive.
+  void close();
+};
+
+/// Write a CSR matrix as an .npz file loadable by `scipy.sparse.load_npz`.
+template <class I, class V>
+inline static void
+write_npz(const std::filesystem::path& path, const csr<I, V>& A, int p = default_threads())
+{
+  std::vector<std::int64_t> shape = { A.n_rows, A.n_cols };
+  npz_writer npz(path);
+  npz.add("indices", A.indices, p);
+  npz.add("indptr", A.offsets, p);
+  npz.add("format", "|S3", {}, "csr", 3);
+  npz.add("shape", shape, 1);
+  npz.add("data", A.values, p);
+  npz.close();
+}
+
+/// Write a COO matrix as an .npz file loadable by `scipy.sparse.load_npz`.
+template <class I, class V>
+inline static void
+write_npz(const std::filesystem::path& path, const coo<I, V>& A, int p = default_threads())
+{
+  std::vector<std::int64_t> shape = { A.n_rows, A.n_cols };
+  npz_writer npz(path);
+  npz.add("row", A.rows, p);
+  npz.add("col", A.cols, p);
+  npz.add("format", "|S3", {}, "coo", 3);
+  npz.add("shape", shape, 1);
+  npz.add("data", A.values, p);
+  npz.close();
+}
+}
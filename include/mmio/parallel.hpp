@@ -0,0 +1,110 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace mmio
+{
+/// The number of threads used by the parallel routines when none is given.
+inline static int
+default_threads()
+{
+  unsigned n = std::thread::hardware_concurrency();
+  return (n) ? n : 1;
+}
+
+/// The beginning of the `t`th of `p` contiguous blocks of `[0, n)`.
+inline static std::ptrdiff_t
+block_begin(std::ptrdiff_t n, int p, int t)
+{
+  return (n * t) / p;
+}
+
+/// Run `f(t)` for each `t` in `[0, p)`, each on its own thread.
+///
+/// Thread 0 runs on the calling thread, so `p == 1` never spawns.
+template <class F>
+inline static void
+parallel(int p, F&& f)
+{
+  std::vector<std::thread> threads;
+  threads.reserve(p - 1);
+  for (int t = 1; t < p; ++t) {
+    threads.emplace_back([&f, t] { f(t); });
+  }
+  f(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+/// Run `f(t, i, j)` over `p` contiguous blocks `[i, j)` of `[0, n)`.
+template <class F>
+inline static void
+parallel_for(std::ptrdiff_t n, int p, F&& f)
+{
+  parallel(p, [&](int t) {
+    f(t, block_begin(n, p, t), block_begin(n, p, t + 1));
+  });
+}
+
+/// In-place parallel inclusive prefix sum of `[first, last)`.
+///
+/// Each thread scans its own block, the block totals are scanned serially,
+/// and each thread then adds its predecessors' total to its block.
+template <class It>
+inline static void
+prefix_sum(It first, It last, int p = default_threads())
+{
+  using T = typename std::iterator_traits<It>::value_type;
+  std::ptrdiff_t n = last - first;
+  if (p == 1 || n < 2 * p) {
+    std::inclusive_scan(first, last, first);
+    return;
+  }
+
+  std::vector<T> sums(p + 1);
+  parallel_for(n, p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t j) {
+    std::inclusive_scan(first + i, first + j, first + i);
+    sums[t + 1] = (i < j) ? first[j - 1] : T();
+  });
+  std::inclusive_scan(sums.begin(), sums.end(), sums.begin());
+  parallel_for(n, p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t j) {
+    for (; i < j; ++i) {
+      first[i] += sums[t];
+    }
+  });
+}
+}
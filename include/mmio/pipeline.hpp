@@ -0,0 +1,276 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+#include "mmio/queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mmio
+{
+/// A fixed-capacity batch of decoded edges in structure-of-arrays form.
+template <class I = std::int32_t, class V = double>
+struct edge_batch
+{
+  std::ptrdiff_t first = 0;                     // ordinal of the first edge
+  std::ptrdiff_t  size = 0;                     // number of edges in use
+  std::vector<I>  rows;
+  std::vector<I>  cols;
+  std::vector<V> values;
+};
+
+/// Thread counts and sizes for `pipeline_edges`.
+struct pipeline_options
+{
+  int parsers = default_threads();
+  int consumers = default_threads();
+  std::ptrdiff_t batch_size = std::ptrdiff_t(1) << 14;
+  std::ptrdiff_t queue_batches = 64;            // full batches in flight
+};
+
+/// Stream the stored edges of `mm` from parser threads to consumer threads.
+///
+/// Parsers decode chunks of the file into `edge_batch`es and push them into
+/// a bounded lock-free queue, where consumers pop them and call
+/// `sink(batch, consumer)` concurrently. Drained batches return to the
+/// parsers through a second queue, so the pipeline only ever holds
+/// `queue_batches + parsers + consumers` batches no matter the file size.
+/// A batch never spans two chunks of `parts`, so its edges have consecutive
+/// ordinals starting at `first`, and batches are never sized larger than the
+/// largest chunk. Pattern files get a value of `V(1)`.
+template <class I = std::int32_t, class V = double, class Sink>
+inline static void
+pipeline_edges(const MatrixMarketFile& mm, const edge_partition& parts, Sink&& sink,
+               const pipeline_options& o = {})
+{
+  int n_parsers = std::max(1, o.parsers);
+  int n_consumers = std::max(1, o.consumers);
+  std::ptrdiff_t n_batches = o.queue_batches + n_parsers + n_consumers;
+
+  // No batch holds more than one chunk, so small files get small batches.
+  std::ptrdiff_t largest = 1;
+  for (std::ptrdiff_t c = 0; c < parts.size(); ++c) {
+    largest = std::max(largest, parts.offsets[c + 1] - parts.offsets[c]);
+  }
+  std::ptrdiff_t batch_size = std::clamp<std::ptrdiff_t>(o.batch_size, 1, largest);
+
+  std::vector<edge_batch<I, V>> pool(n_batches);
+  bounded_queue<edge_batch<I, V>*> empty(n_batches);
+  bounded_queue<edge_batch<I, V>*> full(o.queue_batches);
+  for (auto& b : pool) {
+    b.rows.resize(batch_size);
+    b.cols.resize(batch_size);
+    b.values.resize(batch_size);
+    empty.push(&b);
+  }
+
+  std::atomic<std::ptrdiff_t> next = 0;
+  std::atomic<int> parsing = n_parsers;
+  bool pattern = mm.isPattern();
+
+  auto parse = [&] {
+    edge_batch<I, V>* b;
+    empty.pop(b);
+    for (std::ptrdiff_t c; (c = next.fetch_add(1, std::memory_order_relaxed)) < parts.size(); ) {
+      b->first = parts.offsets[c];
+      b->size = 0;
+      auto append = [&](I u, I v, V w) {
+        b->rows[b->size] = u;
+        b->cols[b->size] = v;
+        b->values[b->size] = w;
+        if (++b->size == batch_size) {
+          std::ptrdiff_t first = b->first + b->size;
+          full.push(b);
+          empty.pop(b);
+          b->first = first;
+          b->size = 0;
+        }
+      };
+      if (pattern) {
+        for (auto&& [u, v] : parts.range(c)) {
+          append(u, v, V(1));
+        }
+      }
+      else {
+        for (auto&& [u, v, w] : parts.range<V>(c)) {
+          append(u, v, w);
+        }
+      }
+      if (b->size) {
+        full.push(b);
+        empty.pop(b);
+      }
+    }
+    empty.push(b);
+    parsing.fetch_sub(1, std::memory_order_release);
+  };
+
+  auto consume = [&](int consumer) {
+    edge_batch<I, V>* b;
+    for (;;) {
+      if (full.try_pop(b)) {
+        sink(static_cast<const edge_batch<I, V>&>(*b), consumer);
+        empty.push(b);
+      }
+      else if (parsing.load(std::memory_order_acquire) == 0) {
+        // Every batch was pushed before its parser finished, so an empty
+        // queue is now final.
+        if (!full.try_pop(b)) {
+          return;
+        }
+        sink(static_cast<const edge_batch<I, V>&>(*b), consumer);
+        empty.push(b);
+      }
+      else {
+        std::this_thread::yield();
+      }
+    }
+  };
+
+  parallel(n_parsers + n_consumers, [&](int t) {
+    if (t < n_parsers) {
+      parse();
+    }
+    else {
+      consume(t - n_parsers);
+    }
+  });
+}
+
+/// Stream the stored edges of `mm` from parser threads to consumer threads,
+/// using several chunks per parser so that parsers finish together.
+template <class I = std::int32_t, class V = double, class Sink>
+inline static void
+pipeline_edges(const MatrixMarketFile& mm, Sink&& sink, const pipeline_options& o = {})
+{
+  int n_parsers = std::max(1, o.parsers);
+  edge_partition parts = partition_edges(mm, 4 * n_parsers, n_parsers);
+  pipeline_edges<I, V>(mm, parts, std::forward<Sink>(sink), o);
+}
+
+/// Load `mm` into a CSR matrix by pipelining the parse into the scatter.
+///
+/// A first pass reads only the index tokens of each line, never the values,
+/// to count the entries of each row. Then the `pipeline_edges` consumers
+/// scatter each batch straight into its rows through atomic per-row cursors
+/// while the parsers move on, so nothing beyond the CSR arrays and the
+/// pipeline's batches is held. Symmetric files are stored according to `s`.
+template <class I = std::int32_t, class V = double>
+inline static csr<I, V>
+build_csr_pipelined(const MatrixMarketFile& mm,
+                    symmetric_storage s = symmetric_storage::full,
+                    const pipeline_options& o = {})
+{
+  bool general = mm.isGeneral();
+  bool mirror = !general && s == symmetric_storage::full;
+  bool upper = !general && s == symmetric_storage::upper;
+  bool skew = mm.isSkew();
+  int p = std::max(1, o.parsers + o.consumers);
+
+  csr<I, V> A;
+  A.n_rows = mm.getNRows();
+  A.n_cols = mm.getNCols();
+  A.offsets.resize(A.n_rows + 1);
+
+  auto count = [&](I u) {
+    std::atomic_ref(A.offsets[u + 1]).fetch_add(1, std::memory_order_relaxed);
+  };
+
+  int n_parsers = std::max(1, o.parsers);
+  edge_partition parts = partition_edges(mm, 4 * n_parsers, n_parsers);
+
+  // Only symmetric files need the column to find an entry's row.
+  using tokens = MatrixMarketFile::edge_iterator<>;
+  bool need_cols = mirror || upper;
+  parallel_for(parts.size(), p, [&](int, std::ptrdiff_t c, std::ptrdiff_t ce) {
+    for (; c < ce; ++c) {
+      for (const char* i = parts.bounds[c], *e = parts.bounds[c + 1]; i < e; ) {
+        I u = tokens::get<std::int32_t>(i) - 1;
+        if (need_cols) {
+          I v = tokens::get<std::int32_t>(i) - 1;
+          count((upper && v < u) ? v : u);
+          if (mirror && u != v) {
+            count(v);
+          }
+        }
+        else {
+          count(u);
+        }
+        auto nl = static_cast<const char*>(std::memchr(i, '\n', e - i));
+        i = (nl) ? nl + 1 : e;
+      }
+    }
+  });
+
+  prefix_sum(A.offsets.begin(), A.offsets.end(), p);
+  A.indices.resize(A.offsets.back());
+  A.values.resize(A.offsets.back());
+
+  std::vector<I> cursor(A.offsets.begin(), A.offsets.end() - 1);
+  auto scatter = [&](I r, I c, V v) {
+    I k = std::atomic_ref(cursor[r]).fetch_add(1, std::memory_order_relaxed);
+    A.indices[k] = c;
+    A.values[k] = v;
+  };
+
+  pipeline_edges<I, V>(mm, parts, [&](const edge_batch<I, V>& b, int) {
+    for (std::ptrdiff_t i = 0; i < b.size; ++i) {
+      I r = b.rows[i], c = b.cols[i];
+      V v = b.values[i];
+      if (upper && c < r) {
+        scatter(c, r, (skew) ? negate(v) : v);
+      }
+      else {
+        scatter(r, c, v);
+      }
+      if (mirror && r != c) {
+        scatter(c, r, (skew) ? negate(v) : v);
+      }
+    }
+  }, o);
+
+  parallel(p, [&](int t) {
+    for (std::int32_t i = A.row_block_begin(p, t), e = A.row_block_begin(p, t + 1); i < e; ++i) {
+      I k = A.offsets[i];
+      sort_row(&A.indices[k], &A.values[k], A.offsets[i + 1] - k);
+    }
+  });
+  return A;
+}
+}
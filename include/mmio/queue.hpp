@@ -0,0 +1,147 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace mmio
+{
+/// A bounded lock-free multi-producer multi-consumer queue.
+///
+/// This is Dmitry Vyukov's array-based queue: each cell carries a sequence
+/// number that tells producers and consumers whether it is free or full for
+/// their ticket, so a push or pop is a single compare-and-swap on the shared
+/// ticket counter in the common case. The capacity is rounded up to a power
+/// of two.
+template <class T>
+class bounded_queue
+{
+  struct cell
+  {
+    std::atomic<std::size_t> sequence;
+    T data;
+  };
+
+  std::unique_ptr<cell[]> cells_;
+  std::size_t mask_;
+  alignas(64) std::atomic<std::size_t> enqueue_ = 0;
+  alignas(64) std::atomic<std::size_t> dequeue_ = 0;
+
+ public:
+  explicit bounded_queue(std::size_t capacity)
+      : cells_(new cell[std::bit_ceil(std::max<std::size_t>(capacity, 2))])
+      , mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+  {
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  std::size_t capacity() const {
+    return mask_ + 1;
+  }
+
+  /// Push `t` unless the queue is full.
+  bool try_push(T t)
+  {
+    std::size_t pos = enqueue_.load(std::memory_order_relaxed);
+    cell* c;
+    for (;;) {
+      c = &cells_[pos & mask_];
+      std::size_t seq = c->sequence.load(std::memory_order_acquire);
+      std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos);
+      if (diff == 0) {
+        if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      }
+      else if (diff < 0) {
+        return false;
+      }
+      else {
+        pos = enqueue_.load(std::memory_order_relaxed);
+      }
+    }
+    c->data = std::move(t);
+    c->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Pop into `t` unless the queue is empty.
+  bool try_pop(T& t)
+  {
+    std::size_t pos = dequeue_.load(std::memory_order_relaxed);
+    cell* c;
+    for (;;) {
+      c = &cells_[pos & mask_];
+      std::size_t seq = c->sequence.load(std::memory_order_acquire);
+      std::intptr_t diff = std::intptr_t(seq) - std::intptr_t(pos + 1);
+      if (diff == 0) {
+        if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      }
+      else if (diff < 0) {
+        return false;
+      }
+      else {
+        pos = dequeue_.load(std::memory_order_relaxed);
+      }
+    }
+    t = std::move(c->data);
+    c->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Push `t`, yielding while the queue is full.
+  void push(T t)
+  {
+    while (!try_push(t)) {
+      std::this_thread::yield();
+    }
+  }
+
+  /// Pop into `t`, yielding while the queue is empty.
+  void pop(T& t)
+  {
+    while (!try_pop(t)) {
+      std::this_thread::yield();
+    }
+  }
+};
+}
@@ -0,0 +1,272 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/rows.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace mmio
+{
+/// A block of consecutive rows of a matrix, parsed into compact CSR form.
+///
+/// Row `first_row + r` has columns `indices[offsets[r], offsets[r + 1])`.
+template <class I = std::int32_t, class V = double>
+struct row_block
+{
+  I first_row = 0;
+  std::vector<I> offsets;
+  std::vector<I> indices;
+  std::vector<V> values;
+
+  I n_rows() const {
+    return offsets.size() - 1;
+  }
+
+  std::size_t bytes() const {
+    return sizeof(*this) + (offsets.size() + indices.size()) * sizeof(I) + values.size() * sizeof(V);
+  }
+};
+
+/// Counters reported by `RowBlockCache::getStats()`.
+struct cache_stats
+{
+  std::int64_t hits = 0;
+  std::int64_t misses = 0;
+  std::int64_t evictions = 0;
+  std::int64_t blocks = 0;                      // resident blocks
+  std::int64_t bytes = 0;                       // resident bytes
+
+  double hit_rate() const {
+    return (hits + misses) ? double(hits) / (hits + misses) : 0.0;
+  }
+};
+
+/// A memory-bounded LRU cache of the row blocks of a row-sorted file.
+///
+/// Rows are grouped into blocks of `block_rows`. The first request for a
+/// block finds its byte range, through the row index when one is given and by
+/// binary search otherwise, and parses it into a `row_block`. Blocks are
+/// evicted least recently used first once the resident blocks exceed the byte
+/// budget, so matrices larger than memory can serve random row queries.
+///
+/// Any number of threads may read concurrently. The lock is only held for
+/// the bookkeeping: blocks are parsed outside it, and readers that request a
+/// block while it is being parsed wait for that parse instead of repeating
+/// it, and count as hits. Blocks are handed out as shared pointers, so an
+/// evicted block stays alive until its last reader drops it.
+///
+/// Symmetric files produce the entries as stored.
+template <class I = std::int32_t, class V = double>
+class RowBlockCache
+{
+ public:
+  using block_ptr = std::shared_ptr<const row_block<I, V>>;
+
+  /// The columns and values of one row, kept alive by its block.
+  struct row_view
+  {
+    block_ptr block;
+    std::span<const I> cols;
+    std::span<const V> values;
+  };
+
+ private:
+  struct entry
+  {
+    std::int32_t block;
+    std::shared_future<block_ptr> future;
+    bool ready = false;
+    std::size_t bytes = 0;
+  };
+
+  const MatrixMarketFile& mm_;
+  const row_index* index_;
+  std::int32_t block_rows_;
+  std::size_t budget_;
+
+  mutable std::mutex lock_;
+  std::list<entry> lru_;                        // most recently used first
+  std::unordered_map<std::int32_t, typename std::list<entry>::iterator> map_;
+  cache_stats stats_;
+
+ public:
+  /// Cache the rows of `mm`, holding at most about `budget` bytes of blocks.
+  RowBlockCache(const MatrixMarketFile& mm, std::size_t budget,
+                std::int32_t block_rows = 1024, const row_index* index = nullptr)
+      : mm_(mm)
+      , index_(index)
+      , block_rows_(std::max(1, block_rows))
+      , budget_(budget)
+  {
+  }
+
+  std::int32_t getBlockRows() const {
+    return block_rows_;
+  }
+
+  std::int32_t getNBlocks() const {
+    return (std::int64_t(mm_.getNRows()) + block_rows_ - 1) / block_rows_;
+  }
+
+  cache_stats getStats() const {
+    std::lock_guard lock(lock_);
+    return stats_;
+  }
+
+  /// Get block `b`, holding rows `[b * getBlockRows(), (b + 1) * getBlockRows())`.
+  block_ptr getBlock(std::int32_t b)
+  {
+    std::unique_lock lock(lock_);
+    if (auto i = map_.find(b); i != map_.end()) {
+      ++stats_.hits;
+      lru_.splice(lru_.begin(), lru_, i->second);
+      std::shared_future<block_ptr> future = i->second->future;
+      lock.unlock();
+      return future.get();
+    }
+
+    ++stats_.misses;
+    std::promise<block_ptr> promise;
+    lru_.push_front({ .block = b, .future = promise.get_future().share() });
+    map_.emplace(b, lru_.begin());
+    lock.unlock();
+
+    // A failed parse is handed to the waiters and leaves no entry behind, so
+    // the next request for the block tries again.
+    block_ptr block;
+    try {
+      block = parse(b);
+    }
+    catch (...) {
+      promise.set_exception(std::current_exception());
+      lock.lock();
+      lru_.erase(map_.at(b));
+      map_.erase(b);
+      throw;
+    }
+    promise.set_value(block);
+
+    lock.lock();
+    auto i = map_.at(b);
+    i->ready = true;
+    i->bytes = block->bytes();
+    stats_.bytes += i->bytes;
+    stats_.blocks += 1;
+    evict();
+    return block;
+  }
+
+  /// Get row `r`.
+  row_view getRow(std::int32_t r)
+  {
+    assert(0 <= r && r < mm_.getNRows());
+    block_ptr block = getBlock(r / block_rows_);
+    I k = r - block->first_row;
+    I i = block->offsets[k], e = block->offsets[k + 1];
+    return {
+      .block = block,
+      .cols = { block->indices.data() + i, std::size_t(e - i) },
+      .values = { block->values.data() + i, std::size_t(e - i) }
+    };
+  }
+
+ private:
+  /// Drop the least recently used parsed blocks until under budget, always
+  /// keeping the most recent one.
+  void evict()
+  {
+    for (auto i = lru_.end(); std::size_t(stats_.bytes) > budget_ && i != lru_.begin(); ) {
+      if (--i == lru_.begin()) {
+        break;
+      }
+      if (!i->ready) {
+        continue;
+      }
+      stats_.bytes -= i->bytes;
+      stats_.blocks -= 1;
+      stats_.evictions += 1;
+      map_.erase(i->block);
+      i = lru_.erase(i);
+    }
+  }
+
+  block_ptr parse(std::int32_t b) const
+  {
+    std::int32_t r0 = b * block_rows_;
+    std::int32_t r1 = std::min<std::int64_t>(std::int64_t(r0) + block_rows_, mm_.getNRows());
+    auto block = std::make_shared<row_block<I, V>>();
+    block->first_row = r0;
+    block->offsets.reserve(r1 - r0 + 1);
+    block->offsets.push_back(0);
+
+    std::int32_t row = r0;
+    auto append = [&](std::int32_t u, std::int32_t v, V w) {
+      if (u < row) {
+        fprintf(stderr, "row cache failed: file is not sorted by row\n");
+        std::exit(EXIT_FAILURE);
+      }
+      for (; row < u; ++row) {
+        block->offsets.push_back(block->indices.size());
+      }
+      block->indices.push_back(v);
+      block->values.push_back(w);
+    };
+
+    if (mm_.isPattern()) {
+      for (auto&& [u, v] : (index_) ? rows(mm_, *index_, r0, r1) : rows(mm_, r0, r1)) {
+        append(u, v, V(1));
+      }
+    }
+    else {
+      for (auto&& [u, v, w] : (index_) ? rows<V>(mm_, *index_, r0, r1) : rows<V>(mm_, r0, r1)) {
+        append(u, v, w);
+      }
+    }
+    for (; row < r1; ++row) {
+      block->offsets.push_back(block->indices.size());
+    }
+    return block;
+  }
+};
+}
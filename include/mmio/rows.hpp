@@ -0,0 +1,151 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/hash.hpp"
+#include "mmio/parallel.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+namespace mmio
+{
+/// The byte offset of the first line of each row of a row-sorted file.
+///
+/// Row `r` occupies bytes `[offsets[r], offsets[r + 1])` of the mapping, and
+/// `file_size` and `content` tie the index to the file it was built from, so
+/// an edit that keeps the size is still caught.
+struct row_index
+{
+  std::int64_t file_size = 0;
+  std::uint64_t content = 0;                    // see `content_hash`
+  std::vector<std::int64_t> offsets;            // n_rows + 1 byte offsets
+};
+
+/// The first line of a row-sorted file whose row is at least `r`, found by
+/// binary search over the mapping.
+///
+/// Each probe moves back to the start of the line it lands in, as
+/// `MatrixMarketFile::edge()` does, and parses only its row index, so this
+/// takes O(log bytes) probes and touches O(log bytes) pages.
+const char* find_row(const MatrixMarketFile& mm, std::int32_t r);
+
+/// A sparse sample of the entries of a sorted file, to shorten searches.
+///
+/// Checkpoint `k` is the line at byte `offsets[k]`, holding entry
+/// (`rows[k]`, `cols[k]`).
+struct entry_checkpoints
+{
+  std::vector<std::int32_t> rows;
+  std::vector<std::int32_t> cols;
+  std::vector<std::int64_t> offsets;
+};
+
+/// Sample about `n` evenly spaced lines of a sorted file as checkpoints.
+///
+/// This reads only the sampled lines, not the whole file.
+entry_checkpoints build_checkpoints(const MatrixMarketFile& mm, std::ptrdiff_t n = 4096);
+
+/// The first line of a file sorted by (row, col) whose entry is at least
+/// (`i`, `j`), found by binary search over the mapping, between the
+/// surrounding checkpoints in `c` when given.
+const char* find_entry(const MatrixMarketFile& mm, std::int32_t i, std::int32_t j,
+                       const entry_checkpoints* c = nullptr);
+
+/// The values stored at 0-based (`i`, `j`) in a file sorted by (row, col),
+/// one for each duplicate entry, and none when the entry is absent.
+///
+/// This is a point lookup for spot checks of files too big to load. Pattern
+/// files produce `V(1)` for each match. Symmetric and skew-symmetric files
+/// store only the lower triangle, so (`i`, `j`) above the diagonal is looked
+/// up as (`j`, `i`), negated for skew files. Complex files produce only the
+/// real part of each value.
+template <class V = double>
+inline static std::vector<V>
+find(const MatrixMarketFile& mm, std::int32_t i, std::int32_t j,
+     const entry_checkpoints* c = nullptr)
+{
+  bool mirrored = !mm.isGeneral() && i < j;
+  if (mirrored) {
+    std::swap(i, j);
+  }
+
+  std::vector<V> values;
+  const char* e = mm.edge(mm.getNEdges());
+  bool pattern = mm.isPattern();
+  for (const char* line = find_entry(mm, i, j, c); line < e; ) {
+    const char* k = line;
+    using tokens = MatrixMarketFile::edge_iterator<>;
+    if (tokens::get<std::int32_t>(k) - 1 != i || tokens::get<std::int32_t>(k) - 1 != j) {
+      break;
+    }
+    V v = (pattern) ? V(1) : tokens::get<V>(k);
+    values.push_back((mirrored && mm.isSkew()) ? negate(v) : v);
+    auto nl = static_cast<const char*>(std::memchr(k, '\n', e - k));
+    line = (nl) ? nl + 1 : e;
+  }
+  return values;
+}
+
+/// Index the rows of a row-sorted file in one parallel pass.
+///
+/// Exits with an error if the file is not sorted by row.
+row_index build_row_index(const MatrixMarketFile& mm, int p = default_threads());
+
+/// Write `index` to `path`.
+void save_row_index(const row_index& index, const std::filesystem::path& path);
+
+/// Read an index written by `save_row_index`, checking that it belongs to a
+/// file with the size and `content_hash` of `mm`.
+row_index load_row_index(const MatrixMarketFile& mm, const std::filesystem::path& path);
+
+/// The edges of rows `[r0, r1)` of a row-sorted file, found by binary search
+/// without loading or indexing the file.
+template <class... Vs>
+inline static MatrixMarketFile::edge_range<Vs...>
+rows(const MatrixMarketFile& mm, std::int32_t r0, std::int32_t r1)
+{
+  return { find_row(mm, r0), find_row(mm, r1) };
+}
+
+/// The edges of rows `[r0, r1)` of a row-sorted file, from its `index`.
+template <class... Vs>
+inline static MatrixMarketFile::edge_range<Vs...>
+rows(const MatrixMarketFile& mm, const row_index& index, std::int32_t r0, std::int32_t r1)
+{
+  const char* base = mm.getBytes().data();
+  return { base + index.offsets[r0], base + index.offsets[r1] };
+}
+}
@@ -0,0 +1,106 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace mmio
+{
+/// Sample `k` distinct edges of `mm` uniformly at random, without a full parse.
+///
+/// A uniformly random byte of the edge section lands in a line with
+/// probability proportional to the line's length, so each probe is accepted
+/// with probability `c / length`, where `c` is the shortest possible edge line
+/// ("1 1\n" or "1 1 1\n"). Accepted lines are uniform, and the expected number
+/// of lines touched is about `k` times the mean line length over `c`.
+///
+/// Samples are drawn without replacement. When `k` is more than half of the
+/// edges, rejection of repeats gets expensive and this falls back to one
+/// sequential selection-sampling pass over the file. The samples are returned
+/// in the order they were drawn.
+template <class... Vs>
+inline static std::vector<typename MatrixMarketFile::edge_iterator<Vs...>::value_type>
+sample_edges(const MatrixMarketFile& mm, std::ptrdiff_t k, std::uint64_t seed)
+{
+  using edge_iterator = MatrixMarketFile::edge_iterator<Vs...>;
+
+  std::vector<typename edge_iterator::value_type> samples;
+  std::mt19937_64 gen(seed);
+  std::ptrdiff_t n = mm.getNEdges();
+  k = std::min(k, n);
+  if (k <= 0) {
+    return samples;
+  }
+  samples.reserve(k);
+
+  if (2 * k > n) {
+    std::ptrdiff_t needed = k;
+    std::ptrdiff_t left = n;
+    for (auto i = edge_iterator(mm.edge(0)), e = edge_iterator(mm.edge(n)); i != e && needed; ++i, --left) {
+      if (std::uniform_int_distribution<std::ptrdiff_t>(0, left - 1)(gen) < needed) {
+        samples.push_back(*i);
+        --needed;
+      }
+    }
+    return samples;
+  }
+
+  std::string_view bytes = mm.getBytes();
+  const char* begin = mm.edge(0);
+  const char* end = bytes.data() + bytes.size();
+  std::ptrdiff_t c = (mm.isPattern()) ? 4 : 6;
+
+  std::uniform_int_distribution<std::ptrdiff_t> offset(0, end - begin - 1);
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  std::unordered_set<const char*> seen;
+  while (std::ssize(samples) < k) {
+    const char* i = begin + offset(gen);
+    while (begin < i && i[-1] != '\n') {
+      --i;
+    }
+    auto newline = static_cast<const char*>(std::memchr(i, '\n', end - i));
+    std::ptrdiff_t length = ((newline) ? newline + 1 : end) - i;
+    if (c < length && c < coin(gen) * length) {
+      continue;
+    }
+    if (seen.insert(i).second) {
+      samples.push_back(*edge_iterator(i));
+    }
+  }
+  return samples;
+}
+}
@@ -0,0 +1,68 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/parallel.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace mmio
+{
+/// How `split_mtx` balances its shards.
+enum class split_mode
+{
+  nnz,                                          // contiguous runs of entries
+  rows                                          // contiguous ranges of rows
+};
+
+/// The path of shard `i` of `stem`, e.g., `stem-00042.mtx`.
+std::filesystem::path shard_path(const std::filesystem::path& stem, std::ptrdiff_t i);
+
+/// Split the .mtx file at `path` into `n` self-contained .mtx shards named by
+/// `shard_path(stem, i)`, using `p` threads, and return the nnz of each.
+///
+/// Every shard has the input's typecode and dimensions and holds a disjoint
+/// subset of the stored entries, so the shards can be opened together with a
+/// `MatrixMarketShardSet`. With `split_mode::nnz` shard boundaries are
+/// line-aligned byte offsets found like `MatrixMarketFile::edge()`, and
+/// each shard is one `copy_file_range` from the input. With
+/// `split_mode::rows` each shard gets a contiguous range of rows chosen to
+/// balance nnz. Row-sorted inputs are still copied as byte ranges, while
+/// unsorted inputs have their lines streamed to each shard, in file order,
+/// through small per-shard buffers and without being reformatted. All shards
+/// are open at once in that case.
+std::vector<std::ptrdiff_t> split_mtx(const std::filesystem::path& path,
+                                      const std::filesystem::path& stem,
+                                      int n,
+                                      split_mode mode = split_mode::nnz,
+                                      int p = default_threads());
+}
@@ -0,0 +1,121 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace mmio
+{
+/// Tokenized edges with their value fields left as raw text.
+///
+/// Edge `k` has 0-based indices `rows[k]` and `cols[k]`, and its `n_fields`
+/// value fields are `field(k, 0)` through `field(k, n_fields - 1)`, which
+/// point into the file's mapping. Missing fields are empty.
+struct token_batch
+{
+  int n_fields = 0;
+  std::vector<std::int32_t> rows;
+  std::vector<std::int32_t> cols;
+  std::vector<std::string_view> fields;         // n_fields per edge
+
+  std::ptrdiff_t size() const {
+    return rows.size();
+  }
+
+  std::string_view field(std::ptrdiff_t k, int f) const {
+    return fields[k * n_fields + f];
+  }
+};
+
+/// Tokenize the `n` edges starting at line `i` into slot `k` onwards of
+/// `out`, which must already be sized.
+inline static void
+tokenize(const char* i, std::ptrdiff_t n, std::ptrdiff_t k, token_batch& out)
+{
+  using tokens = MatrixMarketFile::edge_iterator<>;
+  for (std::ptrdiff_t e = k + n; k < e; ++k) {
+    const char* j = i;
+    out.rows[k] = tokens::get<std::int32_t>(j) - 1;
+    out.cols[k] = tokens::get<std::int32_t>(j) - 1;
+    for (int f = 0; f < out.n_fields; ++f) {
+      out.fields[k * out.n_fields + f] = tokens::get<std::string_view>(j);
+    }
+    const char* line = std::strchr(j, '\n');
+    i = (line) ? line + 1 : j + std::strlen(j);
+  }
+}
+
+/// Tokenize the edges in the line-aligned bytes `[i, e)` into a new batch
+/// with `n_fields` raw fields per edge, e.g., a chunk of an `edge_partition`.
+inline static token_batch
+tokenize(const char* i, const char* e, int n_fields)
+{
+  token_batch out;
+  out.n_fields = n_fields;
+  std::ptrdiff_t n = count_lines(i, e);
+  out.rows.resize(n);
+  out.cols.resize(n);
+  out.fields.resize(n * n_fields);
+  tokenize(i, n, 0, out);
+  return out;
+}
+
+/// The number of value fields per edge of `mm`'s field type.
+inline static int
+value_fields(const MatrixMarketFile& mm)
+{
+  return (mm.isPattern()) ? 0 : (mm.isComplex()) ? 2 : 1;
+}
+
+/// Tokenize every edge of `mm`, in parallel, with `n_fields` raw fields per
+/// edge, e.g., `value_fields(mm)`.
+inline static token_batch
+tokenize_edges(const MatrixMarketFile& mm, int n_fields, int p = default_threads())
+{
+  edge_partition parts = partition_edges(mm, p);
+
+  token_batch out;
+  out.n_fields = n_fields;
+  out.rows.resize(parts.edges());
+  out.cols.resize(parts.edges());
+  out.fields.resize(parts.edges() * n_fields);
+  parallel(p, [&](int t) {
+    tokenize(parts.bounds[t], parts.offsets[t + 1] - parts.offsets[t], parts.offsets[t], out);
+  });
+  return out;
+}
+}
@@ -0,0 +1,272 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string_view>
+
+namespace mmio
+{
+/// Round and clamp `x` into the range of the arithmetic type `T`.
+template <class T, class U>
+inline static T
+saturate(U x)
+{
+  if constexpr (std::is_floating_point_v<U> && std::is_integral_v<T>) {
+    if (std::isnan(x)) {
+      return T(0);
+    }
+    x = std::nearbyint(x);
+  }
+  if constexpr (std::numeric_limits<T>::digits < std::numeric_limits<U>::digits ||
+                std::is_signed_v<T> != std::is_signed_v<U>) {
+    if (x < U(0) && !std::is_signed_v<T>) {
+      return T(0);
+    }
+    if (std::is_signed_v<T> && x <= U(std::numeric_limits<T>::lowest())) {
+      return std::numeric_limits<T>::lowest();
+    }
+    if (U(std::numeric_limits<T>::max()) <= x) {
+      return std::numeric_limits<T>::max();
+    }
+  }
+  return T(x);
+}
+
+/// The customization point for parsing a value field as a `T`.
+///
+/// A specialization provides `static T parse(const char*& i)`, which reads
+/// the field starting at `i`, skipping leading blanks, and leaves `i` just
+/// past it. Every edge iterator, builder, and batch decoder parses values
+/// through it, so a type without a specialization is a compile-time error.
+/// Types that convert from `double` can derive from `double_parser<T>`:
+///
+/// ```
+/// template <> struct mmio::value_parser<my_type> : mmio::double_parser<my_type> {};
+/// ```
+template <class T>
+struct value_parser
+{
+};
+
+/// Types that have a `value_parser`.
+template <class T>
+concept parsable = requires(const char*& i) {
+  { value_parser<T>::parse(i) } -> std::convertible_to<T>;
+};
+
+/// Parse a field with `strtod` and convert it to a `T`.
+template <class T>
+struct double_parser
+{
+  static T parse(const char*& i) {
+    char* e;
+    T t = T(std::strtod(i, &e));
+    i = e;
+    return t;
+  }
+};
+
+/// Integers are parsed as `long long` and saturated to `T`, so out-of-range
+/// fields clamp to the limits of `T` rather than wrapping, and negative
+/// fields give 0 for unsigned types. Only `unsigned long long` and unsigned
+/// types as wide as it are parsed as `unsigned long long`.
+template <std::integral T>
+struct value_parser<T>
+{
+  static T parse(const char*& i) {
+    // This horrible code is used because normal stream processing is very
+    // slow, while this direct version is just sort of slow.
+    char* e;
+    T t;
+    if constexpr (std::is_signed_v<T> || std::numeric_limits<T>::digits < std::numeric_limits<long long>::digits) {
+      t = saturate<T>(std::strtoll(i, &e, 10));
+    }
+    else {
+      // strtoull negates a negative field rather than rejecting it.
+      const char* j = i;
+      while (*j == ' ' || *j == '\t') {
+        ++j;
+      }
+      std::uint64_t x = (*j == '-') ? (std::strtoll(i, &e, 10), 0) : std::strtoull(i, &e, 10);
+      t = T(x);
+    }
+    i = e;
+    return t;
+  }
+};
+
+template <>
+struct value_parser<float>
+{
+  static float parse(const char*& i) {
+    char* e;
+    float f = std::strtof(i, &e);
+    i = e;
+    return f;
+  }
+};
+
+template <>
+struct value_parser<double> : double_parser<double>
+{
+};
+
+template <>
+struct value_parser<long double>
+{
+  static long double parse(const char*& i) {
+    char* e;
+    long double d = std::strtold(i, &e);
+    i = e;
+    return d;
+  }
+};
+
+/// The raw field, pointing into the mapping, for callers with their own
+/// value formats.
+template <>
+struct value_parser<std::string_view>
+{
+  static std::string_view parse(const char*& i) {
+    while (*i == ' ' || *i == '\t') {
+      ++i;
+    }
+    const char* j = i;
+    while (*j && !std::isspace(static_cast<unsigned char>(*j))) {
+      ++j;
+    }
+    std::string_view s = { i, std::size_t(j - i) };
+    i = j;
+    return s;
+  }
+};
+
+/// A 16-bit brain floating point storage type.
+///
+/// This keeps the top 16 bits of an IEEE single with round-to-nearest-even,
+/// and is only meant as a compact storage format: arithmetic happens after
+/// converting back to `float`.
+struct bfloat16
+{
+  std::uint16_t bits = 0;
+
+  bfloat16() = default;
+
+  bfloat16(float f) {
+    std::uint32_t u = std::bit_cast<std::uint32_t>(f);
+    if (std::isnan(f)) {
+      bits = (u >> 16) | 0x40;                  // keep NaN quiet
+    }
+    else {
+      bits = (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+    }
+  }
+
+  operator float() const {
+    return std::bit_cast<float>(std::uint32_t(bits) << 16);
+  }
+
+  bfloat16 operator-() const {
+    bfloat16 b;
+    b.bits = bits ^ 0x8000;
+    return b;
+  }
+};
+
+/// A signed fixed-point number with `F` fractional bits stored in a `T`.
+///
+/// Conversion from `double` rounds to the nearest representable value and
+/// saturates at the range of `T`.
+template <std::signed_integral T, int F>
+requires (0 <= F && F < std::numeric_limits<T>::digits)
+struct fixed
+{
+  static constexpr double one = double(std::int64_t(1) << F);
+
+  T raw = 0;
+
+  fixed() = default;
+
+  fixed(double d)
+      : raw(saturate<T>(d * one))
+  {
+  }
+
+  operator double() const {
+    return raw / one;
+  }
+
+  fixed operator-() const {
+    fixed f;
+    f.raw = saturate<T>(-std::int64_t(raw));
+    return f;
+  }
+};
+
+template <>
+struct value_parser<bfloat16>
+{
+  static bfloat16 parse(const char*& i) {
+    return value_parser<float>::parse(i);
+  }
+};
+
+template <std::signed_integral T, int F>
+struct value_parser<fixed<T, F>> : double_parser<fixed<T, F>>
+{
+};
+
+/// Affine quantization `q = round(x / scale) + zero_point`, saturated to `T`.
+///
+/// Pass one to the converting builders to quantize values as they are
+/// parsed. Skew-symmetric mirroring negates the quantized value, which is
+/// only exact for a zero `zero_point`.
+template <std::integral T>
+struct quantizer
+{
+  double scale = 1.0;
+  T zero_point = 0;
+
+  T operator()(double x) const {
+    return saturate<T>(std::nearbyint(x / scale) + zero_point);
+  }
+
+  double dequantize(T q) const {
+    return (double(q) - zero_point) * scale;
+  }
+};
+}
@@ -0,0 +1,277 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "mmio/builders.hpp"
+#include "mmio/parallel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace mmio
+{
+/// Format the banner and size line of a coordinate file with the 4-character
+/// MM_typecode `typecode`, e.g., "MCRG" or "MCPS".
+std::string mtx_header(std::string_view typecode,
+                       std::int32_t n_rows,
+                       std::int32_t n_cols,
+                       std::ptrdiff_t nnz);
+
+/// Create or truncate `path` for writing, returning its file descriptor.
+int open_output(const std::filesystem::path& path);
+
+/// Write `[data, data + n)` at byte `offset` of `fd`.
+void pwrite_all(int fd, const char* data, std::size_t n, std::ptrdiff_t offset);
+
+/// Close a file descriptor returned by `open_output`.
+void close_output(int fd);
+
+/// Format a single value with the shortest round-trip representation.
+template <class V>
+inline static char*
+format_value(char* first, char* last, V v)
+{
+  if constexpr (std::is_arithmetic_v<V>) {
+    return std::to_chars(first, last, v).ptr;
+  }
+  else {
+    return std::to_chars(first, last, double(v)).ptr;
+  }
+}
+
+/// Append a formatted value and a separator to `out`.
+template <class V>
+inline static void
+append_value(std::string& out, V v, char separator)
+{
+  char buffer[64];
+  char* e = format_value(buffer, buffer + sizeof(buffer), v);
+  out.append(buffer, e);
+  out.push_back(separator);
+}
+
+/// Write coordinate entries as a .mtx file, in parallel.
+///
+/// This is the shared implementation of the writers. The entries live in
+/// `slots` (rows, columns, or single entries), where `slot_begin(parts, t)`
+/// returns the first slot of the `t`th of `parts` ranges with balanced nnz
+/// and `visit(a, e, f)` calls `f(row, col, value)` for each entry in slots
+/// `[a, e)`.
+///
+/// Only one value is written per entry, so complex typecodes are rejected.
+/// For symmetric, skew-symmetric, and hermitian typecodes only one triangle
+/// is written, with rows no less than columns as the format requires.
+/// `stored` says which triangle the input holds so that `upper` input is
+/// transposed on the way out, while `full` and `stored` input keep their
+/// lower entries.
+///
+/// The output is formatted in chunks of about `chunk_nnz` entries. Each
+/// round formats `p` chunks in parallel, places them with a prefix sum over
+/// their sizes, and `pwrite`s them concurrently.
+template <class V, class Begin, class Visit>
+inline static void
+write_entries(const std::filesystem::path& path,
+              std::int32_t n_rows, std::int32_t n_cols, std::ptrdiff_t nnz,
+              std::string_view typecode,
+              symmetric_storage stored,
+              int p,
+              Begin&& slot_begin,
+              Visit&& visit,
+              std::ptrdiff_t chunk_nnz = std::ptrdiff_t(1) << 20)
+{
+  assert(typecode.size() == 4 && typecode[0] == 'M' && typecode[1] == 'C');
+  if (typecode[2] == 'C') {
+    fprintf(stderr, "write_mtx failed: complex values are not supported\n");
+    std::exit(EXIT_FAILURE);
+  }
+  bool pattern = (typecode[2] == 'P');
+  bool general = (typecode[3] == 'G');
+  bool skew = (typecode[3] == 'K');
+  bool upper = (stored == symmetric_storage::upper);
+
+  auto keep = [&](std::int64_t r, std::int64_t c) {
+    if (general) {
+      return true;
+    }
+    if (upper) {
+      return (skew) ? r < c : r <= c;
+    }
+    return (skew) ? r > c : r >= c;
+  };
+
+  std::vector<std::ptrdiff_t> counts(p + 1);
+  parallel(p, [&](int t) {
+    visit(slot_begin(p, t), slot_begin(p, t + 1), [&](std::int64_t r, std::int64_t c, const V&) {
+      counts[t + 1] += keep(r, c);
+    });
+  });
+  prefix_sum(counts.begin(), counts.end(), 1);
+
+  std::string header = mtx_header(typecode, n_rows, n_cols, counts[p]);
+  int fd = open_output(path);
+  pwrite_all(fd, header.data(), header.size(), 0);
+  std::ptrdiff_t offset = header.size();
+
+  std::ptrdiff_t n_chunks = std::max<std::ptrdiff_t>(1, (nnz + chunk_nnz - 1) / chunk_nnz);
+  for (std::ptrdiff_t round = 0; round < n_chunks; round += p) {
+    int q = std::min<std::ptrdiff_t>(p, n_chunks - round);
+    std::vector<std::string> chunks(q);
+    std::vector<std::ptrdiff_t> sizes(q + 1);
+
+    parallel(q, [&](int t) {
+      std::string& out = chunks[t];
+      out.reserve(chunk_nnz * 32);
+      visit(slot_begin(n_chunks, round + t), slot_begin(n_chunks, round + t + 1),
+            [&](std::int64_t r, std::int64_t c, const V& v) {
+              if (!keep(r, c)) {
+                return;
+              }
+              if (!general && r < c) {
+                std::swap(r, c);
+              }
+              append_value(out, r + 1, ' ');
+              if (pattern) {
+                append_value(out, c + 1, '\n');
+              }
+              else {
+                append_value(out, c + 1, ' ');
+                append_value(out, (skew && upper) ? V(-v) : v, '\n');
+              }
+            });
+      sizes[t + 1] = out.size();
+    });
+    prefix_sum(sizes.begin(), sizes.end(), 1);
+
+    parallel(q, [&](int t) {
+      pwrite_all(fd, chunks[t].data(), chunks[t].size(), offset + sizes[t]);
+    });
+    offset += sizes[q];
+  }
+  close_output(fd);
+}
+
+/// Write a compressed matrix as a coordinate .mtx file, in parallel, where
+/// with `by_column` the major index of `offsets` is the column.
+template <class I, class V>
+inline static void
+write_compressed(const std::filesystem::path& path,
+                 std::int32_t n_rows, std::int32_t n_cols,
+                 const std::vector<I>& offsets,
+                 const std::vector<I>& indices,
+                 const std::vector<V>& values,
+                 bool by_column,
+                 std::string_view typecode,
+                 symmetric_storage stored,
+                 int p,
+                 std::ptrdiff_t chunk_nnz = std::ptrdiff_t(1) << 20)
+{
+  std::ptrdiff_t n = offsets.size() - 1;
+  std::ptrdiff_t nnz = indices.size();
+
+  auto slot_begin = [&](std::ptrdiff_t parts, std::ptrdiff_t t) {
+    auto i = std::lower_bound(offsets.begin(), offsets.end(), I((nnz * t) / parts));
+    return std::min<std::ptrdiff_t>(i - offsets.begin(), n);
+  };
+
+  auto visit = [&](std::ptrdiff_t a, std::ptrdiff_t e, auto&& f) {
+    for (; a < e; ++a) {
+      for (I k = offsets[a]; k < offsets[a + 1]; ++k) {
+        if (by_column) {
+          f(indices[k], a, values[k]);
+        }
+        else {
+          f(a, indices[k], values[k]);
+        }
+      }
+    }
+  };
+
+  write_entries<V>(path, n_rows, n_cols, nnz, typecode, stored, p, slot_begin, visit, chunk_nnz);
+}
+
+/// Write a CSR matrix as a coordinate .mtx file, in parallel.
+///
+/// See `write_compressed` for how `typecode` and `stored` select the output.
+template <class I, class V>
+inline static void
+write_mtx(const std::filesystem::path& path,
+          const csr<I, V>& A,
+          std::string_view typecode = "MCRG",
+          symmetric_storage stored = symmetric_storage::full,
+          int p = default_threads())
+{
+  write_compressed(path, A.n_rows, A.n_cols, A.offsets, A.indices, A.values,
+                   false, typecode, stored, p);
+}
+
+/// Write a CSC matrix as a coordinate .mtx file, in parallel.
+template <class I, class V>
+inline static void
+write_mtx(const std::filesystem::path& path,
+          const csc<I, V>& A,
+          std::string_view typecode = "MCRG",
+          symmetric_storage stored = symmetric_storage::full,
+          int p = default_threads())
+{
+  write_compressed(path, A.n_rows, A.n_cols, A.offsets, A.indices, A.values,
+                   true, typecode, stored, p);
+}
+
+/// Write a COO matrix as a coordinate .mtx file, in parallel, in entry order.
+template <class I, class V>
+inline static void
+write_mtx(const std::filesystem::path& path,
+          const coo<I, V>& A,
+          std::string_view typecode = "MCRG",
+          symmetric_storage stored = symmetric_storage::full,
+          int p = default_threads())
+{
+  auto slot_begin = [&](std::ptrdiff_t parts, std::ptrdiff_t t) {
+    return (A.nnz() * t) / parts;
+  };
+
+  auto visit = [&](std::ptrdiff_t k, std::ptrdiff_t e, auto&& f) {
+    for (; k < e; ++k) {
+      f(A.rows[k], A.cols[k], A.values[k]);
+    }
+  };
+
+  write_entries<V>(path, A.n_rows, A.n_cols, A.nnz(), typecode, stored, p, slot_begin, visit);
+}
+}
@@ -70,6 +70,8 @@ mmio::MatrixMarketFile::MatrixMarketFile(std::filesystem::path path)
     std::exit(EXIT_FAILURE);
   }
 
+  std::memcpy(type_, type, sizeof(type_));
+
   switch (mm_read_mtx_crd_size(f, &n_, &m_, &nnz_)) {
    case MM_PREMATURE_EOF:    // if an end-of-file is encountered before processing these three values.
     fclose(f);
@@ -103,6 +105,15 @@ mmio::MatrixMarketFile::release()
   base_ = nullptr;
 }
 
+bool mmio::MatrixMarketFile::isPattern() const   { return mm_is_pattern(type_); }
+bool mmio::MatrixMarketFile::isInteger() const   { return mm_is_integer(type_); }
+bool mmio::MatrixMarketFile::isReal() const      { return mm_is_real(type_); }
+bool mmio::MatrixMarketFile::isComplex() const   { return mm_is_complex(type_); }
+bool mmio::MatrixMarketFile::isGeneral() const   { return mm_is_general(type_); }
+bool mmio::MatrixMarketFile::isSymmetric() const { return mm_is_symmetric(type_); }
+bool mmio::MatrixMarketFile::isSkew() const      { return mm_is_skew(type_); }
+bool mmio::MatrixMarketFile::isHermitian() const { return mm_is_hermitian(type_); }
+
 const char*
 mmio::MatrixMarketFile::edge(std::ptrdiff_t n) const
 {
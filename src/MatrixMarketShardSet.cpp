@@ -0,0 +1,79 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mmio/MatrixMarketShardSet.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+mmio::MatrixMarketShardSet::MatrixMarketShardSet(const std::vector<std::filesystem::path>& paths, int p)
+    : shards_(paths.size())
+    , offsets_(paths.size() + 1)
+{
+  if (paths.empty()) {
+    fprintf(stderr, "shard set is empty\n");
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Threads claim paths one at a time so that a few slow opens don't hold
+  // up a whole block of shards.
+  std::atomic<std::size_t> next = 0;
+  parallel(std::min<std::size_t>(std::max(1, p), paths.size()), [&](int) {
+    for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < paths.size(); ) {
+      shards_[i] = std::make_unique<MatrixMarketFile>(paths[i]);
+    }
+  });
+
+  const MatrixMarketFile& first = *shards_.front();
+  for (std::size_t i = 0; i < shards_.size(); ++i) {
+    const MatrixMarketFile& shard = *shards_[i];
+    if (shard.getNRows() != first.getNRows() || shard.getNCols() != first.getNCols()) {
+      fprintf(stderr, "shard %s is %d x %d, expected %d x %d\n", paths[i].c_str(),
+              shard.getNRows(), shard.getNCols(), first.getNRows(), first.getNCols());
+      std::exit(EXIT_FAILURE);
+    }
+    if (std::memcmp(shard.getTypecode(), first.getTypecode(), 4) != 0) {
+      fprintf(stderr, "shard %s has typecode %.4s, expected %.4s\n", paths[i].c_str(),
+              shard.getTypecode(), first.getTypecode());
+      std::exit(EXIT_FAILURE);
+    }
+    offsets_[i + 1] = offsets_[i] + shard.getNEdges();
+  }
+}
+
+void
+mmio::MatrixMarketShardSet::release()
+{
+  for (auto& shard : shards_) {
+    shard->release();
+  }
+}
@@ -0,0 +1,144 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mmio/arrow.hpp"
+
+#include <cstring>
+
+namespace
+{
+/// The storage behind an exported schema and its children.
+struct schema_data
+{
+  std::string format;
+  std::string name;
+  std::string metadata;
+  std::vector<ArrowSchema*> children;
+};
+
+/// The storage behind an exported array: its buffer and child pointer
+/// arrays, and a reference to the owner of the buffers themselves.
+struct array_data
+{
+  std::vector<const void*> buffers;
+  std::vector<ArrowArray*> children;
+  std::shared_ptr<const void> owner;
+};
+
+void
+release_schema(ArrowSchema* schema)
+{
+  auto data = static_cast<schema_data*>(schema->private_data);
+  for (ArrowSchema* child : data->children) {
+    if (child->release) {
+      child->release(child);
+    }
+    delete child;
+  }
+  delete data;
+  schema->release = nullptr;
+}
+
+void
+release_array(ArrowArray* array)
+{
+  auto data = static_cast<array_data*>(array->private_data);
+  for (ArrowArray* child : data->children) {
+    if (child->release) {
+      child->release(child);
+    }
+    delete child;
+  }
+  delete data;
+  array->release = nullptr;
+}
+}
+
+std::string
+mmio::arrow_metadata(const std::vector<std::pair<std::string, std::string>>& pairs)
+{
+  std::string out;
+  auto append = [&](std::int32_t n) {
+    out.append(reinterpret_cast<const char*>(&n), sizeof(n));
+  };
+
+  append(pairs.size());
+  for (auto& [key, value] : pairs) {
+    append(key.size());
+    out += key;
+    append(value.size());
+    out += value;
+  }
+  return out;
+}
+
+void
+mmio::export_arrow_schema(const arrow_field& field, ArrowSchema* out)
+{
+  auto data = new schema_data{ field.format, field.name, field.metadata, {} };
+  for (const arrow_field& child : field.children) {
+    data->children.push_back(new ArrowSchema);
+    export_arrow_schema(child, data->children.back());
+  }
+
+  *out = {
+    .format = data->format.c_str(),
+    .name = data->name.c_str(),
+    .metadata = (data->metadata.empty()) ? nullptr : data->metadata.data(),
+    .flags = 0,
+    .n_children = std::int64_t(data->children.size()),
+    .children = data->children.data(),
+    .dictionary = nullptr,
+    .release = release_schema,
+    .private_data = data
+  };
+}
+
+void
+mmio::export_arrow_array(const arrow_node& node, std::shared_ptr<const void> owner, ArrowArray* out)
+{
+  auto data = new array_data{ node.buffers, {}, owner };
+  for (const arrow_node& child : node.children) {
+    data->children.push_back(new ArrowArray);
+    export_arrow_array(child, owner, data->children.back());
+  }
+
+  *out = {
+    .length = node.length,
+    .null_count = 0,
+    .offset = 0,
+    .n_buffers = std::int64_t(data->buffers.size()),
+    .n_children = std::int64_t(data->children.size()),
+    .buffers = data->buffers.data(),
+    .children = data->children.data(),
+    .dictionary = nullptr,
+    .release = release_array,
+    .private_data = data
+  };
+}
@@ -0,0 +1,92 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mmio/batch.hpp"
+#include "mmio/binary.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+
+extern "C" {
+#include "mmio.h"
+}
+
+mmio::small_mtx
+mmio::read_small_mtx(const std::filesystem::path& path, std::string& buffer)
+{
+  int fd = open_input(path);
+  struct stat st;
+  if (fstat(fd, &st)) {
+    fprintf(stderr, "fstat failed, %d: %s\n", errno, strerror(errno));
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Terminate the last line so that edge iteration stops at the end. The
+  // string's own nul keeps the parser from running off of it.
+  buffer.resize(st.st_size);
+  pread_all(fd, buffer.data(), st.st_size, 0);
+  close_input(fd);
+  if (buffer.empty() || buffer.back() != '\n') {
+    buffer.push_back('\n');
+  }
+
+  FILE* f = fmemopen(buffer.data(), buffer.size(), "r");
+  if (f == nullptr) {
+    fprintf(stderr, "fmemopen failed, %d: %s\n", errno, strerror(errno));
+    std::exit(EXIT_FAILURE);
+  }
+
+  small_mtx mtx;
+  MM_typecode type;
+  if (mm_read_banner(f, &type) || !mm_is_coordinate(type)) {
+    fprintf(stderr, "%s: not a coordinate MatrixMarket file\n", path.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  if (mm_read_mtx_crd_size(f, &mtx.n_rows, &mtx.n_cols, &mtx.nnz)) {
+    fprintf(stderr, "%s: missing size line\n", path.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  std::memcpy(mtx.typecode, type, sizeof(mtx.typecode));
+  long i = ftell(f);
+  fclose(f);
+
+  // Drop trailing blank lines, which would otherwise parse as edges.
+  const char* begin = buffer.data() + i;
+  const char* end = buffer.data() + buffer.size();
+  while (begin < end && std::isspace(static_cast<unsigned char>(end[-1]))) {
+    --end;
+  }
+  mtx.begin = begin;
+  mtx.end = (begin < end) ? static_cast<const char*>(std::memchr(end, '\n', buffer.data() + buffer.size() - end)) + 1 : begin;
+  return mtx;
+}
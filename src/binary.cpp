@@ -0,0 +1,119 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mmio/binary.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+std::int64_t
+mmio::binary_header::array(int i) const
+{
+  auto align = [](std::int64_t n) {
+    return (n + 63) & ~std::int64_t(63);
+  };
+
+  std::int64_t offset = align(sizeof(binary_header));
+  std::int64_t sizes[3] = {
+    ((layout == binary_layout::csr) ? n_rows + 1 : nnz) * index_size,
+    nnz * index_size,
+    nnz * value_size
+  };
+  for (int j = 0; j < i; ++j) {
+    offset = align(offset + sizes[j]);
+  }
+  return offset;
+}
+
+int
+mmio::open_input(const std::filesystem::path& path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "open failed, %d: %s\n", errno, strerror(errno));
+    std::exit(EXIT_FAILURE);
+  }
+  return fd;
+}
+
+void
+mmio::pread_all(int fd, char* data, std::size_t n, std::ptrdiff_t offset)
+{
+  while (n) {
+    ssize_t bytes = pread(fd, data, n, offset);
+    if (bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "pread failed, %d: %s\n", errno, strerror(errno));
+      std::exit(EXIT_FAILURE);
+    }
+    if (bytes == 0) {
+      fprintf(stderr, "pread failed: unexpected end of file\n");
+      std::exit(EXIT_FAILURE);
+    }
+    data += bytes;
+    offset += bytes;
+    n -= bytes;
+  }
+}
+
+void
+mmio::close_input(int fd)
+{
+  if (close(fd)) {
+    fprintf(stderr, "close failed, %d: %s\n", errno, strerror(errno));
+  }
+}
+
+mmio::binary_header
+mmio::read_binary_header(int fd)
+{
+  binary_header h;
+  binary_header expected;
+  pread_all(fd, reinterpret_cast<char*>(&h), sizeof(h), 0);
+  if (std::memcmp(h.magic, expected.magic, sizeof(h.magic)) || h.version != expected.version) {
+    fprintf(stderr, "not an mmio binary file\n");
+    std::exit(EXIT_FAILURE);
+  }
+  return h;
+}
+
+mmio::binary_header
+mmio::read_binary_header(const std::filesystem::path& path)
+{
+  int fd = open_input(path);
+  binary_header h = read_binary_header(fd);
+  close_input(fd);
+  return h;
+}
@@ -0,0 +1,118 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mmio/hash.hpp"
+
+#include <bit>
+#include <cstring>
+
+namespace {
+constexpr std::uint64_t P1 = 11400714785074694791ull;
+constexpr std::uint64_t P2 = 14029467366897019727ull;
+constexpr std::uint64_t P3 =  1609587929392839161ull;
+constexpr std::uint64_t P4 =  9650029242287828579ull;
+constexpr std::uint64_t P5 =  2870177450012600261ull;
+
+std::uint64_t read64(const char* p)
+{
+  std::uint64_t u;
+  std::memcpy(&u, p, sizeof(u));
+  return u;
+}
+
+std::uint32_t read32(const char* p)
+{
+  std::uint32_t u;
+  std::memcpy(&u, p, sizeof(u));
+  return u;
+}
+
+std::uint64_t round(std::uint64_t acc, std::uint64_t input)
+{
+  acc += input * P2;
+  acc = std::rotl(acc, 31);
+  return acc * P1;
+}
+
+std::uint64_t merge(std::uint64_t acc, std::uint64_t v)
+{
+  acc ^= round(0, v);
+  return acc * P1 + P4;
+}
+}
+
+std::uint64_t
+mmio::hash_bytes(const char* data, std::size_t n, std::uint64_t seed)
+{
+  const char* e = data + n;
+  std::uint64_t h;
+
+  if (n >= 32) {
+    std::uint64_t v1 = seed + P1 + P2;
+    std::uint64_t v2 = seed + P2;
+    std::uint64_t v3 = seed;
+    std::uint64_t v4 = seed - P1;
+    for (; data + 32 <= e; data += 32) {
+      v1 = round(v1, read64(data));
+      v2 = round(v2, read64(data + 8));
+      v3 = round(v3, read64(data + 16));
+      v4 = round(v4, read64(data + 24));
+    }
+    h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+    h = merge(h, v1);
+    h = merge(h, v2);
+    h = merge(h, v3);
+    h = merge(h, v4);
+  }
+  else {
+    h = seed + P5;
+  }
+
+  h += n;
+  for (; data + 8 <= e; data += 8) {
+    h ^= round(0, read64(data));
+    h = std::rotl(h, 27) * P1 + P4;
+  }
+  if (data + 4 <= e) {
+    h ^= std::uint64_t(read32(data)) * P1;
+    h = std::rotl(h, 23) * P2 + P3;
+    data += 4;
+  }
+  for (; data < e; ++data) {
+    h ^= std::uint64_t(std::uint8_t(*data)) * P5;
+    h = std::rotl(h, 11) * P1;
+  }
+
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+  return h;
+}
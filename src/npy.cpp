@@ -0,0 +1,295 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mmio/npy.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace {
+constexpr std::uint32_t ZIP64 = 0xffffffff;
+
+constexpr std::array<std::uint32_t, 256> crc_table = [] {
+  std::array<std::uint32_t, 256> table = {};
+  for (std::uint32_t i = 0; i < 256; ++i) {
+    std::uint32_t c = i;
+    for (int k = 0; k < 8; ++k) {
+      c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+    }
+    table[i] = c;
+  }
+  return table;
+}();
+
+/// Append little-endian fixed-width integers to a zip record.
+template <class T>
+void put(std::string& out, T value)
+{
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    out.push_back(char(std::uint64_t(value) >> (8 * i)));
+  }
+}
+
+/// Multiply a GF(2) 32x32 matrix by a vector, as in zlib's crc32_combine.
+std::uint32_t gf2_times(const std::uint32_t* matrix, std::uint32_t vector)
+{
+  std::uint32_t sum = 0;
+  for (; vector; vector >>= 1, ++matrix) {
+    if (vector & 1) {
+      sum ^= *matrix;
+    }
+  }
+  return sum;
+}
+
+void gf2_square(std::uint32_t* square, const std::uint32_t* matrix)
+{
+  for (int n = 0; n < 32; ++n) {
+    square[n] = gf2_times(matrix, matrix[n]);
+  }
+}
+}
+
+std::string
+mmio::npy_header(std::string_view descr, const std::vector<std::int64_t>& shape, std::ptrdiff_t offset)
+{
+  std::string dict = "{'descr': '";
+  dict += descr;
+  dict += "', 'fortran_order': False, 'shape': (";
+  for (std::int64_t n : shape) {
+    dict += std::to_string(n);
+    dict += ", ";
+  }
+  if (shape.size() > 1) {
+    dict.resize(dict.size() - 1);
+    dict.back() = ')';
+  }
+  else if (shape.size() == 1) {
+    dict.back() = ')';
+  }
+  else {
+    dict += ')';
+  }
+  dict += ", }";
+
+  // magic, version, length, dictionary, padding, newline
+  std::ptrdiff_t n = 6 + 2 + 2 + dict.size() + 1;
+  std::ptrdiff_t pad = (64 - (offset + n) % 64) % 64;
+  dict.append(pad, ' ');
+  dict.push_back('\n');
+
+  std::string header("\x93NUMPY\x01\x00", 8);
+  put(header, std::uint16_t(dict.size()));
+  return header + dict;
+}
+
+std::uint32_t
+mmio::crc32(const char* data, std::size_t n, std::uint32_t crc)
+{
+  crc = ~crc;
+  for (std::size_t i = 0; i < n; ++i) {
+    crc = crc_table[(crc ^ std::uint8_t(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+std::uint32_t
+mmio::crc32_combine(std::uint32_t a, std::uint32_t b, std::size_t n)
+{
+  if (n == 0) {
+    return a;
+  }
+
+  // Apply n zero bytes to `a` by repeated squaring of the one-zero-bit
+  // operator.
+  std::uint32_t even[32], odd[32];
+  odd[0] = 0xedb88320;
+  for (int i = 1; i < 32; ++i) {
+    odd[i] = std::uint32_t(1) << (i - 1);
+  }
+  gf2_square(even, odd);                        // two zero bits
+  gf2_square(odd, even);                        // four zero bits
+
+  do {
+    gf2_square(even, odd);
+    if (n & 1) {
+      a = gf2_times(even, a);
+    }
+    n >>= 1;
+    if (n == 0) {
+      break;
+    }
+    gf2_square(odd, even);
+    if (n & 1) {
+      a = gf2_times(odd, a);
+    }
+    n >>= 1;
+  } while (n);
+  return a ^ b;
+}
+
+mmio::npz_writer::npz_writer(const std::filesystem::path& path)
+    : fd_(open_output(path))
+{
+}
+
+mmio::npz_writer::~npz_writer()
+{
+  if (fd_ >= 0) {
+    close();
+  }
+}
+
+void
+mmio::npz_writer::add(std::string_view name, std::string_view descr,
+                      const std::vector<std::int64_t>& shape,
+                      const char* data, std::size_t bytes,
+                      int p)
+{
+  // The .npy header is at most a few hundred bytes, so this decides zip64
+  // before its exact size is known.
+  std::string file = std::string(name) + ".npy";
+  bool zip64 = bytes + 4096 >= ZIP64;
+  std::int64_t start = offset_ + 30 + file.size() + ((zip64) ? 20 : 0);
+  std::string header = npy_header(descr, shape, start);
+  std::int64_t size = header.size() + bytes;
+
+  // Write and checksum the array in parallel blocks.
+  std::vector<std::uint32_t> crcs(p);
+  std::vector<std::int64_t> lengths(p);
+  std::int64_t data_offset = start + header.size();
+  parallel_for(bytes, p, [&](int t, std::ptrdiff_t i, std::ptrdiff_t e) {
+    pwrite_all(fd_, data + i, e - i, data_offset + i);
+    crcs[t] = mmio::crc32(data + i, e - i);
+    lengths[t] = e - i;
+  });
+  std::uint32_t crc = mmio::crc32(header.data(), header.size());
+  for (int t = 0; t < p; ++t) {
+    crc = crc32_combine(crc, crcs[t], lengths[t]);
+  }
+
+  std::string local;
+  put(local, std::uint32_t(0x04034b50));        // local file header
+  put(local, std::uint16_t((zip64) ? 45 : 20)); // version needed
+  put(local, std::uint16_t(0));                 // flags
+  put(local, std::uint16_t(0));                 // stored
+  put(local, std::uint16_t(0));                 // time
+  put(local, std::uint16_t(0x21));              // date, 1980-01-01
+  put(local, crc);
+  put(local, std::uint32_t((zip64) ? ZIP64 : size));
+  put(local, std::uint32_t((zip64) ? ZIP64 : size));
+  put(local, std::uint16_t(file.size()));
+  put(local, std::uint16_t((zip64) ? 20 : 0));
+  local += file;
+  if (zip64) {
+    put(local, std::uint16_t(1));
+    put(local, std::uint16_t(16));
+    put(local, std::uint64_t(size));
+    put(local, std::uint64_t(size));
+  }
+  local += header;
+  pwrite_all(fd_, local.data(), local.size(), offset_);
+
+  members_.push_back({ std::move(file), crc, size, offset_ });
+  offset_ = data_offset + bytes;
+}
+
+void
+mmio::npz_writer::close()
+{
+  std::string directory;
+  for (const member& m : members_) {
+    bool big = m.size >= ZIP64;
+    bool far = m.offset >= ZIP64;
+    std::string extra;
+    if (big || far) {
+      put(extra, std::uint16_t(1));
+      put(extra, std::uint16_t(8 * (2 * big + far)));
+      if (big) {
+        put(extra, std::uint64_t(m.size));
+        put(extra, std::uint64_t(m.size));
+      }
+      if (far) {
+        put(extra, std::uint64_t(m.offset));
+      }
+    }
+
+    put(directory, std::uint32_t(0x02014b50));  // central directory header
+    put(directory, std::uint16_t(45));          // version made by
+    put(directory, std::uint16_t((extra.empty()) ? 20 : 45));
+    put(directory, std::uint16_t(0));
+    put(directory, std::uint16_t(0));
+    put(directory, std::uint16_t(0));
+    put(directory, std::uint16_t(0x21));
+    put(directory, m.crc);
+    put(directory, std::uint32_t((big) ? ZIP64 : m.size));
+    put(directory, std::uint32_t((big) ? ZIP64 : m.size));
+    put(directory, std::uint16_t(m.name.size()));
+    put(directory, std::uint16_t(extra.size()));
+    put(directory, std::uint16_t(0));           // comment
+    put(directory, std::uint16_t(0));           // disk
+    put(directory, std::uint16_t(0));           // internal attributes
+    put(directory, std::uint32_t(0));           // external attributes
+    put(directory, std::uint32_t((far) ? ZIP64 : m.offset));
+    directory += m.name;
+    directory += extra;
+  }
+
+  std::int64_t start = offset_;
+  std::int64_t n = members_.size();
+  std::int64_t size = directory.size();
+  if (start >= ZIP64) {
+    put(directory, std::uint32_t(0x06064b50)); // zip64 end of central directory
+    put(directory, std::uint64_t(44));
+    put(directory, std::uint16_t(45));
+    put(directory, std::uint16_t(45));
+    put(directory, std::uint32_t(0));
+    put(directory, std::uint32_t(0));
+    put(directory, std::uint64_t(n));
+    put(directory, std::uint64_t(n));
+    put(directory, std::uint64_t(size));
+    put(directory, std::uint64_t(start));
+    put(directory, std::uint32_t(0x07064b50)); // zip64 locator
+    put(directory, std::uint32_t(0));
+    put(directory, std::uint64_t(start + size));
+    put(directory, std::uint32_t(1));
+  }
+  put(directory, std::uint32_t(0x06054b50));    // end of central directory
+  put(directory, std::uint16_t(0));
+  put(directory, std::uint16_t(0));
+  put(directory, std::uint16_t(n));
+  put(directory, std::uint16_t(n));
+  put(directory, std::uint32_t(size));
+  put(directory, std::uint32_t((start >= ZIP64) ? ZIP64 : start));
+  put(directory, std::uint16_t(0));
+
+  pwrite_all(fd_, directory.data(), directory.size(), start);
+  close_output(fd_);
+  fd_ = -1;
+}
@@ -0,0 +1,266 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mmio/rows.hpp"
+#include "mmio/binary.hpp"
+#include "mmio/hash.hpp"
+#include "mmio/writers.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <string.h>
+
+namespace {
+constexpr char row_index_magic[8] = { 'M', 'M', 'I', 'O', 'R', 'O', 'W', '\1' };
+
+/// The row of the line starting at `i`, where blank lines, like trailing
+/// ones at the end of the file, sort after every row.
+std::int32_t row_of(const char* i)
+{
+  char* e;
+  long r = std::strtol(i, &e, 10);
+  return (e != i) ? r - 1 : std::numeric_limits<std::int32_t>::max();
+}
+
+/// The start of the line after the one starting at or containing `i`.
+const char* next_line(const char* i, const char* e)
+{
+  auto j = static_cast<const char*>(std::memchr(i, '\n', e - i));
+  return (j) ? j + 1 : e;
+}
+
+/// The (row, col) of the line starting at `i`, ordered like `row_of`.
+std::pair<std::int32_t, std::int32_t> entry_of(const char* i)
+{
+  char* e;
+  long r = std::strtol(i, &e, 10);
+  if (e == i) {
+    return { std::numeric_limits<std::int32_t>::max(), 0 };
+  }
+  return { r - 1, std::strtol(e, nullptr, 10) - 1 };
+}
+
+/// The first line start in `[lo, hi]` for which `less(line)` is false, by
+/// binary search over bytes.
+///
+/// `lo` must be a line start and `hi` a line start or the end. Each probe
+/// moves back to the start of the line it lands in.
+template <class Less>
+const char* lower_bound_line(const char* lo, const char* hi, Less&& less)
+{
+  while (lo < hi) {
+    const char* mid = lo + (hi - lo) / 2;
+    auto nl = static_cast<const char*>(memrchr(lo, '\n', mid - lo));
+    mid = (nl) ? nl + 1 : lo;
+    if (less(mid)) {
+      lo = next_line(mid, hi);
+    }
+    else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+}
+
+const char*
+mmio::find_row(const MatrixMarketFile& mm, std::int32_t r)
+{
+  const char* lo = mm.edge(0);
+  const char* hi = mm.edge(mm.getNEdges());
+  if (r <= 0) {
+    return lo;
+  }
+  return lower_bound_line(lo, hi, [r](const char* i) { return row_of(i) < r; });
+}
+
+mmio::entry_checkpoints
+mmio::build_checkpoints(const MatrixMarketFile& mm, std::ptrdiff_t n)
+{
+  const char* base = mm.getBytes().data();
+  const char* lo = mm.edge(0);
+  const char* hi = mm.edge(mm.getNEdges());
+
+  entry_checkpoints c;
+  for (std::ptrdiff_t k = 0; k < n; ++k) {
+    const char* i = lo + ((hi - lo) * k) / n;
+    auto nl = static_cast<const char*>(memrchr(lo, '\n', i - lo));
+    i = (nl) ? nl + 1 : lo;
+    if (i == hi || (!c.offsets.empty() && base + c.offsets.back() == i)) {
+      continue;
+    }
+    auto [u, v] = entry_of(i);
+    c.rows.push_back(u);
+    c.cols.push_back(v);
+    c.offsets.push_back(i - base);
+  }
+  return c;
+}
+
+const char*
+mmio::find_entry(const MatrixMarketFile& mm, std::int32_t i, std::int32_t j,
+                 const entry_checkpoints* c)
+{
+  const char* base = mm.getBytes().data();
+  const char* lo = mm.edge(0);
+  const char* hi = mm.edge(mm.getNEdges());
+  auto less = [&](std::int32_t u, std::int32_t v) {
+    return u < i || (u == i && v < j);
+  };
+
+  // Narrow the search to the checkpoints on either side of (i, j).
+  if (c) {
+    std::ptrdiff_t a = 0, b = c->offsets.size();
+    while (a < b) {
+      std::ptrdiff_t m = a + (b - a) / 2;
+      if (less(c->rows[m], c->cols[m])) {
+        a = m + 1;
+      }
+      else {
+        b = m;
+      }
+    }
+    if (a < std::ssize(c->offsets)) {
+      hi = base + c->offsets[a];
+    }
+    if (0 < a) {
+      lo = base + c->offsets[a - 1];
+    }
+  }
+
+  return lower_bound_line(lo, hi, [&](const char* line) {
+    auto [u, v] = entry_of(line);
+    return less(u, v);
+  });
+}
+
+mmio::row_index
+mmio::build_row_index(const MatrixMarketFile& mm, int p)
+{
+  std::string_view bytes = mm.getBytes();
+  const char* base = bytes.data();
+  const char* end = mm.edge(mm.getNEdges());
+
+  row_index index;
+  index.file_size = bytes.size();
+  index.content = content_hash(mm, p);
+  index.offsets.resize(mm.getNRows() + 1);
+
+  // Each thread records the offsets of the rows that start inside its chunk,
+  // and the boundary and empty rows are filled in afterward.
+  std::vector<const char*> bounds(p + 1);
+  for (int t = 0; t <= p; ++t) {
+    bounds[t] = mm.edge((std::ptrdiff_t(mm.getNEdges()) * t) / p);
+  }
+
+  std::vector<std::int32_t> first(p, -1), last(p, -1);
+  std::vector<char> sorted(p, true);
+  parallel(p, [&](int t) {
+    for (const char* i = bounds[t]; i < bounds[t + 1]; i = next_line(i, bounds[t + 1])) {
+      std::int32_t u = std::min(row_of(i), mm.getNRows());
+      if (first[t] < 0) {
+        first[t] = u;
+      }
+      else if (u < last[t]) {
+        sorted[t] = false;
+        return;
+      }
+      else {
+        // Sorted chunks whose row ranges overlap write the same rows before
+        // the order across chunks is checked, so these stores are atomic.
+        for (std::int32_t r = last[t] + 1; r <= u; ++r) {
+          std::atomic_ref(index.offsets[r]).store(i - base, std::memory_order_relaxed);
+        }
+      }
+      last[t] = u;
+    }
+  });
+
+  std::int32_t prev = -1;
+  for (int t = 0; t < p; ++t) {
+    if (!sorted[t] || (0 <= first[t] && first[t] < prev)) {
+      fprintf(stderr, "row index failed: file is not sorted by row\n");
+      std::exit(EXIT_FAILURE);
+    }
+    if (first[t] < 0) {
+      continue;
+    }
+    for (std::int32_t r = prev + 1; r <= first[t]; ++r) {
+      index.offsets[r] = bounds[t] - base;
+    }
+    prev = last[t];
+  }
+  for (std::int32_t r = prev + 1; r <= mm.getNRows(); ++r) {
+    index.offsets[r] = end - base;
+  }
+  return index;
+}
+
+void
+mmio::save_row_index(const row_index& index, const std::filesystem::path& path)
+{
+  std::int64_t header[4] = {
+    0, index.file_size, std::int64_t(index.content), std::int64_t(index.offsets.size())
+  };
+  std::memcpy(header, row_index_magic, sizeof(row_index_magic));
+  int fd = open_output(path);
+  pwrite_all(fd, reinterpret_cast<const char*>(header), sizeof(header), 0);
+  pwrite_all(fd, reinterpret_cast<const char*>(index.offsets.data()),
+             index.offsets.size() * sizeof(std::int64_t), sizeof(header));
+  close_output(fd);
+}
+
+mmio::row_index
+mmio::load_row_index(const MatrixMarketFile& mm, const std::filesystem::path& path)
+{
+  std::int64_t header[4];
+  int fd = open_input(path);
+  pread_all(fd, reinterpret_cast<char*>(header), sizeof(header), 0);
+  if (std::memcmp(header, row_index_magic, sizeof(row_index_magic)) ||
+      header[1] != std::int64_t(mm.getBytes().size()) ||
+      std::uint64_t(header[2]) != content_hash(mm) ||
+      header[3] != std::int64_t(mm.getNRows()) + 1) {
+    fprintf(stderr, "row index failed: %s does not match the file\n", path.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+
+  row_index index;
+  index.file_size = header[1];
+  index.content = header[2];
+  index.offsets.resize(header[3]);
+  pread_all(fd, reinterpret_cast<char*>(index.offsets.data()), header[3] * sizeof(std::int64_t), sizeof(header));
+  close_input(fd);
+  return index;
+}
@@ -0,0 +1,301 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mmio/split.hpp"
+#include "mmio/MatrixMarketFile.hpp"
+#include "mmio/binary.hpp"
+#include "mmio/builders.hpp"
+#include "mmio/writers.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+namespace
+{
+/// Copy `n` bytes at `from` in `in` to `to` in `out` inside the kernel,
+/// falling back to writing from the mapping `base` of `in` when the file
+/// systems don't support `copy_file_range`.
+void
+copy_range(int in, int out, const char* base, std::ptrdiff_t from, std::ptrdiff_t to, std::ptrdiff_t n)
+{
+  loff_t i = from, o = to;
+  while (n) {
+    ssize_t copied = copy_file_range(in, &i, out, &o, n, 0);
+    if (copied < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL) {
+        break;
+      }
+      fprintf(stderr, "copy_file_range failed, %d: %s\n", errno, strerror(errno));
+      std::exit(EXIT_FAILURE);
+    }
+    if (copied == 0) {
+      break;
+    }
+    n -= copied;
+  }
+  mmio::pwrite_all(out, base + i, n, o);
+}
+
+/// The start of the line `k` lines after `i`.
+const char*
+advance_lines(const char* i, const char* e, std::ptrdiff_t k)
+{
+  for (; k && i < e; --k) {
+    auto j = static_cast<const char*>(std::memchr(i, '\n', e - i));
+    i = (j) ? j + 1 : e;
+  }
+  return i;
+}
+
+/// The 0-based row of the entry on the line `[i, j)`, or -1 for a blank line.
+///
+/// Leading blanks are skipped by hand, since `strtol` would skip a blank
+/// line's newline and read the next line's row.
+std::int32_t
+line_row(const char* i, const char* j)
+{
+  while (i < j && std::isspace(static_cast<unsigned char>(*i))) {
+    ++i;
+  }
+  if (i == j) {
+    return -1;
+  }
+  char* k;
+  std::int32_t u = std::strtol(i, &k, 10) - 1;
+  return (k != i) ? u : -1;
+}
+
+/// The start of the line after the one starting at `i`.
+const char*
+next_line(const char* i, const char* e)
+{
+  auto j = static_cast<const char*>(std::memchr(i, '\n', e - i));
+  return (j) ? j + 1 : e;
+}
+
+/// Run `f(i)` for each shard `i` in `[0, n)`, claiming shards dynamically.
+template <class F>
+void
+for_each_shard(int n, int p, F&& f)
+{
+  std::atomic<int> next = 0;
+  mmio::parallel(std::max(1, std::min(p, n)), [&](int) {
+    for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n; ) {
+      f(i);
+    }
+  });
+}
+}
+
+std::filesystem::path
+mmio::shard_path(const std::filesystem::path& stem, std::ptrdiff_t i)
+{
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), "-%05td.mtx", i);
+  std::filesystem::path path = stem;
+  path += suffix;
+  return path;
+}
+
+std::vector<std::ptrdiff_t>
+mmio::split_mtx(const std::filesystem::path& path,
+                const std::filesystem::path& stem,
+                int n,
+                split_mode mode,
+                int p)
+{
+  MatrixMarketFile mm(path);
+  std::string_view bytes = mm.getBytes();
+  const char* base = bytes.data();
+  const char* end = base + bytes.size();
+  int in = open_input(path);
+
+  std::vector<std::ptrdiff_t> nnz(n);
+  std::vector<const char*> bounds(n + 1);       // byte ranges, when copyable
+
+  auto write_header = [&](int i, int fd) {
+    std::string header = mtx_header({ mm.getTypecode(), 4 }, mm.getNRows(), mm.getNCols(), nnz[i]);
+    pwrite_all(fd, header.data(), header.size(), 0);
+    return std::ptrdiff_t(header.size());
+  };
+
+  auto copy_shards = [&] {
+    for_each_shard(n, p, [&](int i) {
+      int fd = open_output(shard_path(stem, i));
+      std::ptrdiff_t offset = write_header(i, fd);
+      copy_range(in, fd, base, bounds[i] - base, offset, bounds[i + 1] - bounds[i]);
+      close_output(fd);
+    });
+  };
+
+  if (mode == split_mode::nnz) {
+    edge_partition parts = partition_edges(mm, n, p);
+    for (int i = 0; i < n; ++i) {
+      nnz[i] = parts.offsets[i + 1] - parts.offsets[i];
+    }
+    bounds = parts.bounds;
+    copy_shards();
+    close_input(in);
+    return nnz;
+  }
+
+  // Count the entries in each row and check whether each chunk is sorted.
+  // Blank lines are not entries, and a file with any takes the streaming
+  // path below, which drops them.
+  edge_partition parts = partition_edges(mm, p);
+  std::vector<std::ptrdiff_t> rows(mm.getNRows() + 1);
+  std::vector<char> sorted(p, true);
+  std::vector<std::int32_t> first(p, -1), last(p, -1);
+  parallel(p, [&](int t) {
+    for (const char* i = parts.bounds[t], *e = parts.bounds[t + 1]; i < e; ) {
+      const char* j = next_line(i, e);
+      std::int32_t u = line_row(i, j);
+      i = j;
+      if (u < 0) {
+        sorted[t] = false;
+        continue;
+      }
+      std::atomic_ref(rows[u + 1]).fetch_add(1, std::memory_order_relaxed);
+      sorted[t] &= (last[t] <= u);
+      first[t] = (first[t] < 0) ? u : first[t];
+      last[t] = u;
+    }
+  });
+  prefix_sum(rows.begin(), rows.end(), p);
+
+  bool ordered = std::all_of(sorted.begin(), sorted.end(), [](char s) { return s; });
+  for (int t = 0, prev = -1; t < p; ++t) {
+    if (first[t] >= 0) {
+      ordered &= (prev <= first[t]);
+      prev = last[t];
+    }
+  }
+
+  // Cut the rows where the running nnz crosses each multiple of nnz / n.
+  std::vector<std::int32_t> cuts(n + 1);
+  for (int i = 0; i <= n; ++i) {
+    std::ptrdiff_t target = (rows.back() * i) / n;
+    cuts[i] = std::lower_bound(rows.begin(), rows.end(), target) - rows.begin();
+  }
+  cuts[n] = mm.getNRows();
+  for (int i = 0; i < n; ++i) {
+    nnz[i] = rows[cuts[i + 1]] - rows[cuts[i]];
+  }
+
+  if (ordered) {
+    // Each shard starts at the edge with ordinal rows[cuts[i]], which is
+    // found by counting lines from the start of its chunk.
+    parallel_for(n + 1, p, [&](int, std::ptrdiff_t i, std::ptrdiff_t e) {
+      for (; i < e; ++i) {
+        std::ptrdiff_t k = rows[cuts[i]];
+        std::ptrdiff_t c = std::upper_bound(parts.offsets.begin(), parts.offsets.end() - 1, k) - parts.offsets.begin() - 1;
+        bounds[i] = advance_lines(parts.bounds[c], end, k - parts.offsets[c]);
+      }
+    });
+    bounds[n] = parts.bounds[p];
+    copy_shards();
+    close_input(in);
+    return nnz;
+  }
+
+  // Stream the raw lines of each chunk to their shards. A counting pass
+  // sizes each chunk's piece of each shard, so every chunk writes at its own
+  // offsets through a small buffer per shard, and memory stays bounded no
+  // matter the file size. Blank lines are skipped.
+  auto for_each_line = [&](int t, auto&& f) {
+    for (const char* i = parts.bounds[t], *e = parts.bounds[t + 1]; i < e; ) {
+      const char* j = next_line(i, e);
+      if (std::int32_t u = line_row(i, j); u >= 0) {
+        f(std::upper_bound(cuts.begin(), cuts.end(), u) - cuts.begin() - 1, i, j);
+      }
+      i = j;
+    }
+  };
+
+  std::vector<std::ptrdiff_t> offsets(std::size_t(p) * n);   // [chunk][shard]
+  parallel(p, [&](int t) {
+    std::ptrdiff_t* sizes = &offsets[std::size_t(t) * n];
+    for_each_line(t, [&](std::ptrdiff_t i, const char* line, const char* j) {
+      sizes[i] += (j - line) + (j[-1] != '\n');
+    });
+  });
+
+  std::vector<int> fds(n);
+  for_each_shard(n, p, [&](int i) {
+    fds[i] = open_output(shard_path(stem, i));
+    std::ptrdiff_t offset = write_header(i, fds[i]);
+    for (int t = 0; t < p; ++t) {
+      std::ptrdiff_t size = std::exchange(offsets[std::size_t(t) * n + i], offset);
+      offset += size;
+    }
+  });
+
+  std::ptrdiff_t buffer_size = std::clamp<std::ptrdiff_t>((std::ptrdiff_t(1) << 24) / n, 1 << 12, 1 << 20);
+  parallel(p, [&](int t) {
+    std::ptrdiff_t* cursor = &offsets[std::size_t(t) * n];
+    std::vector<std::string> buffers(n);
+    auto flush = [&](std::ptrdiff_t i) {
+      pwrite_all(fds[i], buffers[i].data(), buffers[i].size(), cursor[i]);
+      cursor[i] += buffers[i].size();
+      buffers[i].clear();
+    };
+    for_each_line(t, [&](std::ptrdiff_t i, const char* line, const char* j) {
+      std::string& buffer = buffers[i];
+      buffer.append(line, j);
+      if (buffer.back() != '\n') {
+        buffer.push_back('\n');
+      }
+      if (std::ssize(buffer) >= buffer_size) {
+        flush(i);
+      }
+    });
+    for (int i = 0; i < n; ++i) {
+      if (!buffers[i].empty()) {
+        flush(i);
+      }
+    }
+  });
+
+  for (int fd : fds) {
+    close_output(fd);
+  }
+  close_input(in);
+  return nnz;
+}
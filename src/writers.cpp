@@ -0,0 +1,98 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2020, 2021 Trustees of Indiana University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "mmio/writers.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern "C" {
+#include "mmio.h"
+}
+
+std::string
+mmio::mtx_header(std::string_view typecode,
+                 std::int32_t n_rows,
+                 std::int32_t n_cols,
+                 std::ptrdiff_t nnz)
+{
+  MM_typecode type;
+  std::memcpy(type, typecode.data(), sizeof(type));
+  char* str = mm_typecode_to_str(type);
+  if (str == nullptr) {
+    fprintf(stderr, "invalid typecode %.4s\n", typecode.data());
+    std::exit(EXIT_FAILURE);
+  }
+
+  char line[MM_MAX_LINE_LENGTH];
+  snprintf(line, sizeof(line), "%s %s\n%d %d %td\n", MatrixMarketBanner, str, n_rows, n_cols, nnz);
+  free(str);
+  return line;
+}
+
+int
+mmio::open_output(const std::filesystem::path& path)
+{
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "open failed, %d: %s\n", errno, strerror(errno));
+    std::exit(EXIT_FAILURE);
+  }
+  return fd;
+}
+
+void
+mmio::pwrite_all(int fd, const char* data, std::size_t n, std::ptrdiff_t offset)
+{
+  while (n) {
+    ssize_t written = pwrite(fd, data, n, offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "pwrite failed, %d: %s\n", errno, strerror(errno));
+      std::exit(EXIT_FAILURE);
+    }
+    data += written;
+    offset += written;
+    n -= written;
+  }
+}
+
+void
+mmio::close_output(int fd)
+{
+  if (close(fd)) {
+    fprintf(stderr, "close failed, %d: %s\n", errno, strerror(errno));
+  }
+}